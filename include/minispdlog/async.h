@@ -24,10 +24,35 @@ namespace minispdlog
 //   // 方式2:自定义线程池配置
 //   minispdlog::init_thread_pool(16384, 2);  // 队列16384,2个线程
 //   auto logger = minispdlog::async_file_mt("async_file", "log.txt");
+//
+//   // 方式3:生产者线程很多时使用无锁队列
+//   minispdlog::initThreadPool(16384, 1, minispdlog::details::QueueType::LockFree);
+//
+//   // 方式4:命名线程池,审计日志与调试日志互相隔离
+//   minispdlog::details::ThreadPoolOptions audit;
+//   audit.queueSize = 65536;
+//   minispdlog::initThreadPool("audit", audit);
+//   auto logger = minispdlog::asyncFileMTLogger("audit", "audit.log", false,
+//       minispdlog::AsyncOverflowPolicy::Block, "audit");
+
+inline void initThreadPool(
+    size_t queueSize = 8192,
+    size_t threadSize = 1,
+    details::QueueType queueType = details::QueueType::Blocking
+)
+{
+    Registry::instance().initThreadPool(queueSize, threadSize, queueType);
+}
 
-inline void initThreadPool(size_t queueSize = 8192, size_t threadSize = 1)
+// 使用完整配置初始化线程池
+// 例:每个生产者线程独占环形队列
+//   minispdlog::details::ThreadPoolOptions options;
+//   options.queueType = minispdlog::details::QueueType::PerThread;
+//   options.ringCapacity = 4096;
+//   minispdlog::initThreadPool(options);
+inline void initThreadPool(const details::ThreadPoolOptions& options)
 {
-    Registry::instance().initThreadPool(queueSize, threadSize);
+    Registry::instance().initThreadPool(options);
 }
 
 inline std::shared_ptr<details::ThreadPool> getThreadPool()
@@ -35,21 +60,40 @@ inline std::shared_ptr<details::ThreadPool> getThreadPool()
     return Registry::instance().getThreadPool();
 }
 
+// 初始化命名线程池,之后在工厂函数的 poolName 参数中使用该名字
+inline void initThreadPool(const std::string& poolName, const details::ThreadPoolOptions& options)
+{
+    Registry::instance().initThreadPool(poolName, options);
+}
+
+// poolName 为空时返回默认线程池
+inline std::shared_ptr<details::ThreadPool> getThreadPool(const std::string& poolName)
+{
+    return Registry::instance().getThreadPool(poolName);
+}
+
+inline void dropThreadPool(const std::string& poolName)
+{
+    Registry::instance().dropThreadPool(poolName);
+}
+
 // ============================================================================
 // 异步 Logger 工厂函数
 // ============================================================================
 
 // 创建异步彩色控制台 logger(多线程安全)
 // overflowpolicy: 溢出策略(默认 block)
+// poolName: 使用的命名线程池(默认为空,使用默认线程池)
 
 inline std::shared_ptr<AsyncLogger> asyncStdoutColorMTLogger(
     const std::string& name,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::ColorConsoleSinkMT>();
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -57,12 +101,13 @@ inline std::shared_ptr<AsyncLogger> asyncStdoutColorMTLogger(
 
 inline std::shared_ptr<AsyncLogger> asyncStderrColorMTLogger(
     const std::string& name,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::ColorStderrSinkMT>();
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -70,12 +115,13 @@ inline std::shared_ptr<AsyncLogger> asyncStderrColorMTLogger(
 
 inline std::shared_ptr<AsyncLogger> asyncStdoutMTLogger(
     const std::string& name,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::ConsoleSinkMT>();
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -83,12 +129,13 @@ inline std::shared_ptr<AsyncLogger> asyncStdoutMTLogger(
 
 inline std::shared_ptr<AsyncLogger> asyncStderrMTLogger(
     const std::string& name,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::StderrSinkMT>();
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -98,12 +145,13 @@ inline std::shared_ptr<AsyncLogger> asyncFileMTLogger(
     const std::string& name,
     const std::string& filename,
     bool truncate = false,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::FileSinkMT>(filename, truncate);
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -114,12 +162,13 @@ inline std::shared_ptr<AsyncLogger> asyncRotatingFileMTLogger(
     const std::string& filename,
     size_t max_size,
     size_t max_files,
-    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
+    AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block,
+    const std::string& poolName = ""
 )
 {
     auto sink = std::make_shared<sinks::RotatingFileSinkMT>(filename, max_size, max_files);
     sink->setFormatter(std::make_unique<PatternFormatter>());   
-    auto threadPool = Registry::instance().getThreadPool();
+    auto threadPool = Registry::instance().getThreadPool(poolName);
     auto logger = std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
     Registry::instance().registerLogger(logger);
     return logger;
@@ -145,6 +194,21 @@ inline std::shared_ptr<AsyncLogger> createAsyncLogger(
     return logger; // 不自动注册,需要手动调用 Registry::instance().registerLogger(logger);
 }
 
+// 在命名线程池上手动创建异步 logger(不自动注册)
+template<typename Sink, typename... SinkArgs>
+inline std::shared_ptr<AsyncLogger> createAsyncLoggerInPool(
+    const std::string& name,
+    const std::string& poolName,
+    AsyncOverflowPolicy overflowPolicy,
+    SinkArgs&&... args
+)
+{
+    auto sink = std::make_shared<Sink>(std::forward<SinkArgs>(args)...);
+    sink->setFormatter(std::make_unique<PatternFormatter>());
+    auto threadPool = Registry::instance().getThreadPool(poolName);
+    return std::make_shared<AsyncLogger>(name, sink, threadPool, overflowPolicy);
+}
+
 // 使用默认溢出策略(block)
 template<typename Sink, typename... SinkArgs>
 inline std::shared_ptr<AsyncLogger> createAsyncLogger(
@@ -3,6 +3,12 @@
 #include "logger.h"
 #include "details/threadpool.h"
 #include <memory>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
 
 namespace minispdlog {
 
@@ -10,10 +16,16 @@ namespace details {
 class ThreadPool;
 }
 
+// 队列满时的处理方式
+// DiscardNew/BlockTimeout/LevelProtected 丢弃的消息计入 logger 自己的 droppedCount/droppedBytes,
+// 并按 setDropReportInterval 的间隔向 sink 补写一条 "N messages dropped" 的警告
 enum class AsyncOverflowPolicy
 {
     Overwrite, // 覆盖旧数据
-    Block // 阻塞等待
+    Block, // 阻塞等待
+    DiscardNew, // 丢弃新消息:不等待也不淘汰旧数据,队列明显已满时连队列的锁都不碰
+    BlockTimeout, // 限时阻塞:最多等待 setOverflowTimeout 设置的时长,超时丢弃新消息
+    LevelProtected // 按级别保护:达到 setProtectedLevel 的消息阻塞投递,绝不丢弃;其余消息按 DiscardNew 处理
 };
 
 class AsyncLogger final: public Logger, public std::enable_shared_from_this<AsyncLogger>
@@ -35,11 +47,101 @@ public:
         AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block
     );
 
-    ~AsyncLogger() override = default;
+    // 等待线程池处理完本 logger 已投递的消息后才析构
+    ~AsyncLogger() override;
 
     AsyncLogger(const AsyncLogger&) = delete;
     AsyncLogger& operator=(const AsyncLogger&) = delete;
 
+    // 异步刷新:返回的 future 在此前投递的所有消息都已写入、sink 刷新之后就绪
+    // 刷新请求在队列中被覆盖丢弃时,future 收到 std::runtime_error
+    std::future<void> flushAsync();
+
+    // 阻塞刷新:最多等待 timeout,按时完成返回 true
+    bool flushFor(std::chrono::milliseconds timeout);
+
+    // 分片模式下指定本 logger 投递到的分片(默认按 ShardAffinity 选择)
+    // 最好在开始记录日志之前设置;已经记录过日志时先等待投递到原分片的消息全部写完再切换
+    // 不能与本 logger 的日志记录并发调用;shard 超出 ThreadPool::shardCount() 时抛出 std::invalid_argument
+    void setShard(size_t shard);
+
+    size_t shard() const
+    {
+        return m_shard;
+    }
+
+    // BlockTimeout 策略的最长等待时间,默认 10ms
+    void setOverflowTimeout(std::chrono::milliseconds timeout)
+    {
+        m_overflowTimeout = timeout;
+    }
+
+    // LevelProtected 策略下不会被丢弃的最低级别,默认 error
+    void setProtectedLevel(level lvl)
+    {
+        m_protectedLevel = lvl;
+    }
+
+    // 两条丢弃报告之间的最短间隔,默认 1s;为 0 时不补写报告,只累计计数
+    void setDropReportInterval(std::chrono::milliseconds interval)
+    {
+        m_dropReportInterval = interval;
+    }
+
+    // 在途配额:本 logger 已投递但尚未写出的消息最多 quota 条(0 表示不限额)
+    // 超出配额时按溢出策略处理(Block 等待自己的消息被写出,DiscardNew 丢弃……),只限制本 logger,
+    // 不会占满共享队列拖累其他 logger;Overwrite 策略不支持配额
+    // 消息没有写出也会归还配额:被共享队列的其他 Overwrite logger 覆盖淘汰、被 ProducerExitPolicy::Discard 丢弃、
+    // 关闭时丢弃;需要在开始记录日志之前设置
+    void setQueueQuota(size_t quota)
+    {
+        m_queueQuota = quota;
+    }
+
+    size_t queueQuota() const
+    {
+        return m_queueQuota;
+    }
+
+    // 当前在途消息数(设置了配额时才统计)
+    size_t inFlightCount() const
+    {
+        return m_inFlight.load(std::memory_order_relaxed);
+    }
+
+    // 投递时碰到配额上限的次数
+    size_t quotaHitCount() const
+    {
+        return m_quotaHits.load(std::memory_order_relaxed);
+    }
+
+    // 因队列满被丢弃的消息条数与 payload 字节数(Overwrite 策略淘汰的旧消息只计入 ThreadPool::overrunCount)
+    size_t droppedCount() const
+    {
+        return m_droppedCount.load(std::memory_order_relaxed);
+    }
+
+    size_t droppedBytes() const
+    {
+        return m_droppedBytes.load(std::memory_order_relaxed);
+    }
+
+    // 达到该级别的消息走线程池的优先通道,不排在积压的普通消息之后,默认 critical
+    // 优先通道的消息总是阻塞投递,不受溢出策略影响:即使 logger 使用 Overwrite/DiscardNew 等不阻塞的策略,
+    // 优先通道满时调用线程也会等待,优先级高的消息不会被丢弃;线程池未启用优先通道时不起作用
+    void setPriorityLevel(level lvl)
+    {
+        m_priorityLevel = lvl;
+    }
+
+    // 开启后,参数全部为算术类型或字符串的日志调用只在调用线程序列化参数,
+    // 由线程池的工作线程完成 fmt 格式化;其他调用仍然立即格式化
+    // 需要在 logger 开始被多个线程使用之前设置
+    void setDeferredFormat(bool enabled)
+    {
+        m_deferredFormat = enabled;
+    }
+
 protected:
     void sinkLog(const details::LogMsg& msg) override;
     void sinkFlush() override;
@@ -47,11 +149,48 @@ protected:
     // 后台线程调用:真正执行日志输出
     // 注意:这个方法在工作线程中执行,不是用户线程
     void backendSinkLog(const details::LogMsg& msg);
+    // 批量版本:每个 sink 只处理一次整批消息
+    void backendSinkLogBatch(const details::LogMsgBatch& msgs);
     void backendSinkFlush();
+    // 线程池关闭时丢弃了 count 条本 logger 的消息
+    void backendDiscard(size_t count);
 
 private:
-    std::weak_ptr<details::ThreadPool> m_threadPool; // 弱引用线程池
+    // 按溢出策略投递一条普通消息,返回 false 表示消息被丢弃
+    bool postWithPolicy(const details::LogMsg& msg);
+    // 配额:wait 为 false 时不等待,否则最多等待 timeout(max 表示一直等)
+    bool quotaEnabled() const
+    {
+        return m_queueQuota > 0 && m_overflowPolicy != AsyncOverflowPolicy::Overwrite;
+    }
+    bool acquireQuota(bool wait, std::chrono::milliseconds timeout);
+    // 工作线程写出消息之后归还配额
+    void releaseQuota(size_t count);
+    void recordDropped(const details::LogMsg& msg);
+    // 把上次报告之后丢弃的条数作为一条 warn 日志投递
+    // force 为 false 时受报告间隔限制且不阻塞;刷新前以 force 调用,阻塞投递
+    void reportDropped(bool force);
+
+    // 构造时锁定线程池并一直持有,投递消息时不再需要 weak_ptr::lock
+    std::shared_ptr<details::ThreadPool> m_threadPool;
     AsyncOverflowPolicy m_overflowPolicy;
+    size_t m_shard{0};
+
+    std::chrono::milliseconds m_overflowTimeout{10};
+    level m_protectedLevel{level::error};
+    level m_priorityLevel{level::critical};
+    std::chrono::milliseconds m_dropReportInterval{1000};
+    std::atomic<size_t> m_droppedCount{0};
+    std::atomic<size_t> m_droppedBytes{0};
+    std::atomic<size_t> m_droppedPending{0};        // 尚未报告的丢弃条数
+    std::atomic<int64_t> m_lastDropReport{0};       // 上次报告的时间(steady_clock 纳秒)
+
+    size_t m_queueQuota{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_inFlight{0};
+    std::atomic<size_t> m_quotaHits{0};
+    std::atomic<size_t> m_quotaWaiters{0};
+    std::mutex m_quotaMutex;
+    std::condition_variable m_quotaCond;
 };
 
 
@@ -12,4 +12,14 @@ namespace minispdlog
     using StringView = std::string_view;
     using LogClock = std::chrono::system_clock;
 
+    // 缓存行大小,用于避免伪共享
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // 格式化器输出时间所用的时区
+    enum class PatternTimeType
+    {
+        Local,  // 本地时间
+        Utc     // UTC
+    };
+
 }
\ No newline at end of file
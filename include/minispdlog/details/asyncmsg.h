@@ -3,6 +3,10 @@
 #include "minispdlog/details/logmsg.h"
 #include <memory>
 #include <string>
+#include <cstring>
+#include <utility>
+#include <future>
+#include <stdexcept>
 
 namespace minispdlog {
 
@@ -14,54 +18,180 @@ enum class AsyncMsgType
 {
     Log,        //日志消息
     Flush,        //刷新日志
-    Shutdown     //关闭日志
+    Shutdown,    //关闭日志
+    Barrier,     //屏障:之前投递的消息全部处理完后通知投递方
+    Wakeup       //唤醒:优先通道有新消息时叫醒在普通队列上挂起的工作线程,本身不做处理
 };
 
+// 异步消息内联保存的 payload 字节数,超过该长度才会在堆上分配
+// 可以在编译时通过 -DMINISPDLOG_ASYNC_INLINE_PAYLOAD_SIZE=N 调整
+#ifndef MINISPDLOG_ASYNC_INLINE_PAYLOAD_SIZE
+#define MINISPDLOG_ASYNC_INLINE_PAYLOAD_SIZE 256
+#endif
+
+// LogMsgBuffer: 持有 payload 副本的 LogMsg
+//   - 短 payload 直接存放在对象内部的定长缓冲区,入队/出队不分配内存
+//   - 长 payload 溢出到堆上,移动时只转移指针
+//   - 移动后 m_payload 指向新对象自己的存储
 struct LogMsgBuffer : LogMsg
 {
-    std::string m_buffer;
-    LogMsgBuffer() = default;
+    static constexpr size_t INLINE_SIZE = MINISPDLOG_ASYNC_INLINE_PAYLOAD_SIZE;
+
+    // 用户提供的默认构造函数:值初始化时不会把内联缓冲区清零
+    LogMsgBuffer() {}
     ~LogMsgBuffer() = default;
 
     explicit LogMsgBuffer(const LogMsg& msg)
-        : LogMsg(msg), m_buffer(msg.m_payload.data(), msg.m_payload.size())
+        : LogMsg(msg)
     {
-        m_payload = StringView(m_buffer.data(), m_buffer.size());
+        storePayload(msg.m_payload);
     }
 
     LogMsgBuffer(LogMsgBuffer&& other) noexcept
-        : LogMsg(std::move(other)),
-          m_buffer(std::move(other.m_buffer))  
+        : LogMsg(std::move(other))
     {
-        m_payload = StringView(m_buffer.data(), m_buffer.size());
-    }  
-    
+        takePayload(other);
+    }
+
     LogMsgBuffer& operator=(LogMsgBuffer&& other) noexcept
     {
         if(this != &other) 
         {
             LogMsg::operator=(std::move(other));
-            m_buffer = std::move(other.m_buffer);
-            m_payload = StringView(m_buffer.data(), m_buffer.size());
+            takePayload(other);
+        }
+        return *this;
+    }
+
+    bool payloadInline() const
+    {
+        return m_payload.data() == m_inline;
+    }
+
+private:
+    void storePayload(StringView payload)
+    {
+        char* dest = m_inline;
+        if (payload.size() > INLINE_SIZE)
+        {
+            if (payload.size() > m_heapCapacity)
+            {
+                m_heap.reset(new char[payload.size()]);
+                m_heapCapacity = payload.size();
+            }
+            dest = m_heap.get();
+        }
+        if (!payload.empty())
+        {
+            std::memcpy(dest, payload.data(), payload.size());
+        }
+        m_payload = StringView(dest, payload.size());
+    }
+
+    // 接管 other 的 payload:内联数据按实际长度拷贝,堆数据直接交换指针
+    void takePayload(LogMsgBuffer& other)
+    {
+        size_t size = other.m_payload.size();
+        if (other.m_payload.data() == other.m_heap.get() && size > 0)
+        {
+            std::swap(m_heap, other.m_heap);
+            std::swap(m_heapCapacity, other.m_heapCapacity);
+            m_payload = StringView(m_heap.get(), size);
+        }
+        else
+        {
+            if (size > 0)
+            {
+                std::memcpy(m_inline, other.m_payload.data(), size);
+            }
+            m_payload = StringView(m_inline, size);
+        }
+        other.m_payload = StringView();
+    }
+
+    char m_inline[INLINE_SIZE];
+    std::unique_ptr<char[]> m_heap;
+    size_t m_heapCapacity{0};
+};
+
+// CompletionToken: 控制消息的完成通知
+//   - arm() 创建 promise 并返回对应的 future,promise 随消息一起移动
+//   - 工作线程处理完消息后调用 complete()
+//   - 消息没有被处理就被丢弃(队列覆盖/线程池销毁)时,future 收到异常,等待方不会永远阻塞
+class CompletionToken
+{
+public:
+    CompletionToken() = default;
+
+    CompletionToken(const CompletionToken&) = delete;
+    CompletionToken& operator=(const CompletionToken&) = delete;
+
+    CompletionToken(CompletionToken&& other) noexcept = default;
+
+    CompletionToken& operator=(CompletionToken&& other) noexcept
+    {
+        if (this != &other)
+        {
+            discard();
+            m_promise = std::move(other.m_promise);
         }
         return *this;
     }
+
+    ~CompletionToken()
+    {
+        discard();
+    }
+
+    std::future<void> arm()
+    {
+        m_promise = std::make_unique<std::promise<void>>();
+        return m_promise->get_future();
+    }
+
+    void complete() noexcept
+    {
+        if (m_promise)
+        {
+            m_promise->set_value();
+            m_promise.reset();
+        }
+    }
+
+private:
+    void discard() noexcept
+    {
+        if (m_promise)
+        {
+            try
+            {
+                m_promise->set_exception(std::make_exception_ptr(
+                    std::runtime_error("async message was discarded before it was processed")));
+            }
+            catch (...)
+            {
+            }
+            m_promise.reset();
+        }
+    }
+
+    std::unique_ptr<std::promise<void>> m_promise;
 };
 
 // AsyncMsg: 异步日志消息
-// 参考 spdlog 设计:继承 LogMsgBuffer + AsyncLogger 的 shared_ptr
+// 参考 spdlog 设计:继承 LogMsgBuffer + 目标 AsyncLogger
 //
-// 关键修正:
-//   - worker_ptr 的类型改为 std::shared_ptr<async_logger> (而不是 logger)
-//   - 这样 thread_pool 可以调用 AsyncLogger 的 backend_sink_it_()
-using AsyncLoggerPtr = std::shared_ptr<minispdlog::AsyncLogger>;
-
+// 与 spdlog 不同,消息只保存 AsyncLogger 的裸指针:
+//   - 投递路径上没有 shared_ptr 引用计数的原子操作,多个生产者不会争抢同一条缓存行
+//   - AsyncLogger 析构时通过 ThreadPool::barrier() 等待自己的消息全部处理完,
+//     以此保证工作线程访问 m_workerPtr 时 logger 仍然存活
 struct AsyncMsg : LogMsgBuffer
 {
     AsyncMsgType m_type{AsyncMsgType::Log};
-    AsyncLoggerPtr m_workerPtr;
+    AsyncLogger* m_workerPtr{nullptr};
+    CompletionToken m_completion;   // Flush/Barrier 消息的完成通知
 
-    AsyncMsg() = default;
+    AsyncMsg() {}
     ~AsyncMsg() = default;
 
     AsyncMsg(const AsyncMsg&) = delete;
@@ -71,7 +201,8 @@ struct AsyncMsg : LogMsgBuffer
     AsyncMsg(AsyncMsg&& other) noexcept
         : LogMsgBuffer(std::move(other)),
           m_type(other.m_type),
-          m_workerPtr(std::move(other.m_workerPtr))
+          m_workerPtr(other.m_workerPtr),
+          m_completion(std::move(other.m_completion))
     {}
 
     //移动赋值运算符
@@ -81,28 +212,30 @@ struct AsyncMsg : LogMsgBuffer
         {
             LogMsgBuffer::operator=(std::move(other));
             m_type = other.m_type;
-            m_workerPtr = std::move(other.m_workerPtr); 
+            m_workerPtr = other.m_workerPtr;
+            m_completion = std::move(other.m_completion);
         }
         return *this;
     }
 
     AsyncMsg(
         AsyncMsgType type,
-        AsyncLoggerPtr&& workerPtr,
+        AsyncLogger* workerPtr,
         const LogMsg& msg
     )
         : LogMsgBuffer(msg),
           m_type(type),
-          m_workerPtr(std::move(workerPtr))
+          m_workerPtr(workerPtr)
     {}
 
+    // 控制消息(Flush/Shutdown/Barrier)
     AsyncMsg(
         AsyncMsgType type,
-        AsyncLoggerPtr&& workerPtr
+        AsyncLogger* workerPtr
     )
         : LogMsgBuffer{},
           m_type(type),
-          m_workerPtr(std::move(workerPtr))
+          m_workerPtr(workerPtr)
     {}
 
     explicit AsyncMsg(AsyncMsgType type)
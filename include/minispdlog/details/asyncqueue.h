@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace minispdlog {
+namespace details {
+
+// AsyncQueue: 线程池使用的队列接口
+// ThreadPool 通过该接口在不同的队列实现之间切换
+template <typename T>
+class AsyncQueue
+{
+public:
+    virtual ~AsyncQueue() = default;
+
+    //入队(阻塞模式):队列满时阻塞等待
+    virtual void enqueue(T&& item) = 0;
+
+    //入队(非阻塞模式):队列满时覆盖最旧的数据
+    virtual void enqueueNoWait(T&& item) = 0;
+
+    //入队(丢弃模式):队列满时放弃本条数据并返回 false,不等待也不覆盖旧数据
+    //返回 false 时 item 保持原样,调用方可以改用其他方式再次入队
+    virtual bool tryEnqueue(T&& item) = 0;
+
+    //入队(限时阻塞):队列满时最多等待 waitDuration,仍然没有空位则放弃本条数据并返回 false
+    virtual bool enqueueFor(T&& item, std::chrono::milliseconds waitDuration) = 0;
+
+    //出队:等待 waitDuration 后仍无数据则返回 false
+    virtual bool dequeueFor(T& item, std::chrono::milliseconds waitDuration) = 0;
+
+    //出队(非阻塞):队列为空时立即返回 false
+    virtual bool tryDequeue(T& item) = 0;
+
+    //批量出队(非阻塞):取出已就绪的数据追加到 items 末尾,最多 maxItems 条
+    virtual size_t tryDequeueBulk(std::vector<T>& items, size_t maxItems)
+    {
+        size_t count = 0;
+        T item;
+        while (count < maxItems && tryDequeue(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    //批量出队:最多等待 waitDuration 拿到第一条,之后把已就绪的数据一并取出
+    //追加到 items 末尾,最多 maxItems 条,返回本次取出的数量
+    virtual size_t dequeueBulkFor(std::vector<T>& items, size_t maxItems, std::chrono::milliseconds waitDuration)
+    {
+        if (maxItems == 0)
+        {
+            return 0;
+        }
+
+        T item;
+        if (!dequeueFor(item, waitDuration))
+        {
+            return 0;
+        }
+        items.push_back(std::move(item));
+
+        size_t count = 1;
+        while (count < maxItems && tryDequeue(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    //等待数据(不取出):最多等待 waitDuration,队列中有数据时返回 true
+    //工作线程挂起时使用,醒来之后再用 tryDequeueBulk 取出;返回 true 之后数据可能已被其他消费者取走
+    virtual bool waitForData(std::chrono::milliseconds waitDuration) = 0;
+
+    //队列是否明显已满(近似值,不加锁):调用 tryEnqueue 之前用它省掉构造注定被放弃的数据
+    //返回 false 不代表一定能入队;默认实现总是返回 false
+    virtual bool approxFull()
+    {
+        return false;
+    }
+
+    //覆盖丢弃的数据条数,不加锁读取
+    virtual size_t overrunCount() = 0;
+    virtual size_t size() const = 0;
+
+    //覆盖淘汰(以及丢弃)的数据在销毁之前交给 handler,例如归还它占用的配额
+    //handler 在淘汰数据的线程(通常是生产者)中调用,可能持有队列内部的锁,不能再访问本队列;需要在入队之前设置
+    void setEvictionHandler(std::function<void(T&)> handler)
+    {
+        m_evictionHandler = std::move(handler);
+    }
+
+    //已经取出、尚未交给 handler 的淘汰数据条数;只有无锁实现中才可能非零
+    //等它回到 0,之前被淘汰的数据就都已处理完
+    virtual size_t evictionsInFlight() const
+    {
+        return 0;
+    }
+
+protected:
+    void evicted(T& item)
+    {
+        if (m_evictionHandler)
+        {
+            m_evictionHandler(item);
+        }
+    }
+
+private:
+    std::function<void(T&)> m_evictionHandler;
+};
+
+}
+}
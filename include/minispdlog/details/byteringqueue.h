@@ -0,0 +1,529 @@
+#pragma once
+
+#include "asyncqueue.h"
+#include "asyncmsg.h"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+namespace minispdlog {
+namespace details {
+
+// ByteRingQueue: 变长记录的字节环形队列
+//   - 所有消息写入同一块连续内存,内存占用恰好等于配置的字节数
+//   - 每条记录 = 记录头(级别/时间/线程 id/源码位置/logger 句柄) + payload 字节
+//   - 记录按 8 字节对齐;尾部放不下时从缓冲区开头继续写(双段环形缓冲区)
+//   - 入队不分配内存;超过整个环的 payload 会被截断
+//
+// 环的状态:
+//   - 未回绕:数据位于 [head, tail)
+//   - 已回绕:数据位于 [head, wrapEnd) 和 [0, tail)
+class ByteRingQueue : public AsyncQueue<AsyncMsg>
+{
+public:
+    explicit ByteRingQueue(size_t capacityBytes)
+        : m_capacity(capacityBytes / RECORD_ALIGN * RECORD_ALIGN),
+          m_buffer(new unsigned char[capacityBytes])
+    {
+        if (m_capacity < MIN_CAPACITY)
+        {
+            throw std::invalid_argument("ByteRingQueue capacity is too small");
+        }
+    }
+
+    ByteRingQueue(const ByteRingQueue&) = delete;
+    ByteRingQueue& operator=(const ByteRingQueue&) = delete;
+
+    ~ByteRingQueue() override
+    {
+        // 析构残留记录(未完成的 Barrier 会在此通知投递方)
+        while (m_count > 0)
+        {
+            popRecord();
+        }
+    }
+
+    //入队(阻塞模式):环内空间不足时等待消费者释放
+    void enqueueRecord(AsyncMsgType type, AsyncLogger* logger, const LogMsg& msg,
+        CompletionToken&& completion = CompletionToken())
+    {
+        if (!fitsWhole(msg))
+        {
+            // 序列化的参数不能截断,先格式化成文本再入队
+            fmt::memory_buffer text;
+            LogMsg formatted = formatNow(msg, text);
+            enqueueRecord(type, logger, formatted, std::move(completion));
+            return;
+        }
+        size_t payloadSize = clampPayload(msg.m_payload.size());
+        size_t recordSize = recordSizeFor(payloadSize);
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            unsigned char* dest = reserve(recordSize);
+            if (dest == nullptr)
+            {
+                ++m_waitingProducers;
+                m_producerCond.wait(lock, [&]() { return (dest = reserve(recordSize)) != nullptr; });
+                --m_waitingProducers;
+            }
+            writeRecord(dest, recordSize, type, logger, msg, payloadSize, std::move(completion));
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+    }
+
+    //入队(非阻塞模式):空间不足时丢弃最旧的记录
+    void enqueueRecordNoWait(AsyncMsgType type, AsyncLogger* logger, const LogMsg& msg,
+        CompletionToken&& completion = CompletionToken())
+    {
+        if (!fitsWhole(msg))
+        {
+            // 序列化的参数不能截断,先格式化成文本再入队
+            fmt::memory_buffer text;
+            LogMsg formatted = formatNow(msg, text);
+            enqueueRecordNoWait(type, logger, formatted, std::move(completion));
+            return;
+        }
+        size_t payloadSize = clampPayload(msg.m_payload.size());
+        size_t recordSize = recordSizeFor(payloadSize);
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            unsigned char* dest;
+            while ((dest = reserve(recordSize)) == nullptr)
+            {
+                evictRecord();
+            }
+            writeRecord(dest, recordSize, type, logger, msg, payloadSize, std::move(completion));
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+    }
+
+    //入队(丢弃模式):空间不足时放弃本条记录并返回 false
+    //环内剩余字节明显不够时不碰互斥锁
+    bool tryEnqueueRecord(AsyncMsgType type, AsyncLogger* logger, const LogMsg& msg,
+        CompletionToken&& completion = CompletionToken())
+    {
+        if (!fitsWhole(msg))
+        {
+            fmt::memory_buffer text;
+            LogMsg formatted = formatNow(msg, text);
+            return tryEnqueueRecord(type, logger, formatted, std::move(completion));
+        }
+        size_t payloadSize = clampPayload(msg.m_payload.size());
+        size_t recordSize = recordSizeFor(payloadSize);
+        if (m_approxUsedBytes.load(std::memory_order_relaxed) + recordSize > m_capacity)
+        {
+            return false;
+        }
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            unsigned char* dest = reserve(recordSize);
+            if (dest == nullptr)
+            {
+                return false;
+            }
+            writeRecord(dest, recordSize, type, logger, msg, payloadSize, std::move(completion));
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+        return true;
+    }
+
+    //入队(限时阻塞):空间不足时最多等待 waitDuration,超时放弃本条记录并返回 false
+    bool enqueueRecordFor(AsyncMsgType type, AsyncLogger* logger, const LogMsg& msg,
+        std::chrono::milliseconds waitDuration, CompletionToken&& completion = CompletionToken())
+    {
+        if (!fitsWhole(msg))
+        {
+            fmt::memory_buffer text;
+            LogMsg formatted = formatNow(msg, text);
+            return enqueueRecordFor(type, logger, formatted, waitDuration, std::move(completion));
+        }
+        size_t payloadSize = clampPayload(msg.m_payload.size());
+        size_t recordSize = recordSizeFor(payloadSize);
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            unsigned char* dest = reserve(recordSize);
+            if (dest == nullptr)
+            {
+                ++m_waitingProducers;
+                bool ready = m_producerCond.wait_for(lock, waitDuration,
+                    [&]() { return (dest = reserve(recordSize)) != nullptr; });
+                --m_waitingProducers;
+                if (!ready)
+                {
+                    return false; //等待超时
+                }
+            }
+            writeRecord(dest, recordSize, type, logger, msg, payloadSize, std::move(completion));
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+        return true;
+    }
+
+    void enqueue(AsyncMsg&& item) override
+    {
+        enqueueRecord(item.m_type, item.m_workerPtr, item, std::move(item.m_completion));
+    }
+
+    void enqueueNoWait(AsyncMsg&& item) override
+    {
+        enqueueRecordNoWait(item.m_type, item.m_workerPtr, item, std::move(item.m_completion));
+    }
+
+    bool tryEnqueue(AsyncMsg&& item) override
+    {
+        return tryEnqueueRecord(item.m_type, item.m_workerPtr, item, std::move(item.m_completion));
+    }
+
+    bool enqueueFor(AsyncMsg&& item, std::chrono::milliseconds waitDuration) override
+    {
+        return enqueueRecordFor(item.m_type, item.m_workerPtr, item, waitDuration, std::move(item.m_completion));
+    }
+
+    bool dequeueFor(AsyncMsg& item, std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!waitNotEmpty(lock, waitDuration))
+        {
+            return false; //等待超时
+        }
+        item = readFront();
+        popRecord();
+        notifyProducers(lock);
+        return true;
+    }
+
+    bool tryDequeue(AsyncMsg& item) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_count == 0)
+        {
+            return false;
+        }
+        item = readFront();
+        popRecord();
+        notifyProducers(lock);
+        return true;
+    }
+
+    size_t dequeueBulkFor(std::vector<AsyncMsg>& items, size_t maxItems, std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!waitNotEmpty(lock, waitDuration))
+        {
+            return 0; //等待超时
+        }
+        return popBulk(lock, items, maxItems);
+    }
+
+    bool waitForData(std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return waitNotEmpty(lock, waitDuration);
+    }
+
+    size_t tryDequeueBulk(std::vector<AsyncMsg>& items, size_t maxItems) override
+    {
+        // 空队列时不碰互斥锁
+        if (m_approxCount.load(std::memory_order_relaxed) == 0)
+        {
+            return 0;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return popBulk(lock, items, maxItems);
+    }
+
+    size_t overrunCount() override
+    {
+        return m_overrunCount.load(std::memory_order_relaxed);
+    }
+
+    // 队列中的记录条数
+    size_t size() const override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
+    }
+
+    // 已占用的字节数(含记录头与对齐填充)
+    size_t usedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_usedBytes;
+    }
+
+    size_t capacityBytes() const
+    {
+        return m_capacity;
+    }
+
+private:
+    // 记录头,通过 placement new 构造在环内,出队时显式析构
+    struct RecordHeader
+    {
+        uint32_t m_recordSize;      // 整条记录的字节数(含头与填充)
+        uint32_t m_payloadSize;
+        AsyncMsgType m_type;
+        level m_level;
+        LogClock::time_point m_timePoint;
+        size_t m_threadId;
+        SourceLocation m_sourceLocation;
+        FormatArgsFn m_formatArgs;
+        uint64_t m_sequence;
+        const char* m_loggerName;   // 指向 logger 自己的名字,logger 析构前会等待队列排空
+        size_t m_loggerNameSize;
+        AsyncLogger* m_logger;
+        CompletionToken m_completion;
+    };
+
+    static constexpr size_t RECORD_ALIGN = alignof(RecordHeader);
+    static constexpr size_t HEADER_SIZE = (sizeof(RecordHeader) + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+    static constexpr size_t MIN_CAPACITY = HEADER_SIZE * 4;
+
+    static size_t recordSizeFor(size_t payloadSize)
+    {
+        return (HEADER_SIZE + payloadSize + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+    }
+
+    // 延迟格式化的记录必须完整写入
+    bool fitsWhole(const LogMsg& msg) const
+    {
+        return msg.m_formatArgs == nullptr || HEADER_SIZE + msg.m_payload.size() <= m_capacity;
+    }
+
+    static LogMsg formatNow(const LogMsg& msg, fmt::memory_buffer& text)
+    {
+        msg.m_formatArgs(msg.m_payload, text);
+        LogMsg formatted(msg);
+        formatted.m_payload = StringView(text.data(), text.size());
+        formatted.m_formatArgs = nullptr;
+        return formatted;
+    }
+
+    // 单条记录最多占满整个环
+    size_t clampPayload(size_t payloadSize) const
+    {
+        size_t maxPayload = m_capacity - HEADER_SIZE;
+        return payloadSize < maxPayload ? payloadSize : maxPayload;
+    }
+
+    // 持有 m_mutex 时调用:为一条记录预留空间,空间不足返回 nullptr
+    unsigned char* reserve(size_t recordSize)
+    {
+        size_t offset;
+        if (m_count == 0)
+        {
+            // 空环:回到起点,保证任何不超过容量的记录都能写入
+            m_head = 0;
+            m_tail = 0;
+            m_wrapped = false;
+        }
+
+        if (!m_wrapped)
+        {
+            if (m_capacity - m_tail >= recordSize)
+            {
+                offset = m_tail;
+            }
+            else if (m_head >= recordSize)
+            {
+                // 尾部剩余空间不够,从开头继续写;[m_tail, m_capacity) 作为填充
+                m_wrapEnd = m_tail;
+                m_wrapped = true;
+                offset = 0;
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+        else
+        {
+            if (m_head - m_tail >= recordSize)
+            {
+                offset = m_tail;
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        m_tail = offset + recordSize;
+        return m_buffer.get() + offset;
+    }
+
+    void writeRecord(unsigned char* dest, size_t recordSize, AsyncMsgType type, AsyncLogger* logger,
+        const LogMsg& msg, size_t payloadSize, CompletionToken&& completion)
+    {
+        new (dest) RecordHeader{
+            static_cast<uint32_t>(recordSize),
+            static_cast<uint32_t>(payloadSize),
+            type,
+            msg.m_level,
+            msg.m_timePoint,
+            msg.m_threadId,
+            msg.m_sourceLocation,
+            msg.m_formatArgs,
+            msg.m_sequence,
+            msg.m_loggerName.data(),
+            msg.m_loggerName.size(),
+            logger,
+            std::move(completion)
+        };
+        if (payloadSize > 0)
+        {
+            std::memcpy(dest + HEADER_SIZE, msg.m_payload.data(), payloadSize);
+        }
+        m_usedBytes += recordSize;
+        ++m_count;
+        m_approxCount.store(m_count, std::memory_order_relaxed);
+        m_approxUsedBytes.store(m_usedBytes, std::memory_order_relaxed);
+    }
+
+    RecordHeader* frontHeader()
+    {
+        return reinterpret_cast<RecordHeader*>(m_buffer.get() + m_head);
+    }
+
+    // 持有 m_mutex 且队列非空时调用:把队头记录还原成 AsyncMsg
+    AsyncMsg readFront()
+    {
+        RecordHeader* header = frontHeader();
+        LogMsg msg(
+            StringView(header->m_loggerName, header->m_loggerNameSize),
+            header->m_level,
+            header->m_timePoint,
+            header->m_sourceLocation,
+            StringView(reinterpret_cast<const char*>(header) + HEADER_SIZE, header->m_payloadSize)
+        );
+        msg.m_threadId = header->m_threadId;
+        msg.m_formatArgs = header->m_formatArgs;
+        msg.m_sequence = header->m_sequence;
+        AsyncMsg item(header->m_type, header->m_logger, msg);
+        item.m_completion = std::move(header->m_completion);
+        return item;
+    }
+
+    // 持有 m_mutex 且队列非空时调用:淘汰队头记录,交给淘汰处理器(处理器不需要 payload,不拷贝)
+    void evictRecord()
+    {
+        RecordHeader* header = frontHeader();
+        AsyncMsg item(header->m_type, header->m_logger);
+        item.m_completion = std::move(header->m_completion);
+        popRecord();
+        m_overrunCount.fetch_add(1, std::memory_order_relaxed);
+        evicted(item);
+    }
+
+    // 持有 m_mutex 且队列非空时调用:析构并移除队头记录
+    void popRecord()
+    {
+        RecordHeader* header = frontHeader();
+        size_t recordSize = header->m_recordSize;
+        header->~RecordHeader();
+
+        m_head += recordSize;
+        m_usedBytes -= recordSize;
+        --m_count;
+        m_approxCount.store(m_count, std::memory_order_relaxed);
+        m_approxUsedBytes.store(m_usedBytes, std::memory_order_relaxed);
+
+        if (m_wrapped && m_head == m_wrapEnd)
+        {
+            m_head = 0;
+            m_wrapped = false;
+        }
+    }
+
+    // 持有 m_mutex 时调用;等待期间登记为挂起的消费者
+    bool waitNotEmpty(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds waitDuration)
+    {
+        if (m_count > 0)
+        {
+            return true;
+        }
+        ++m_waitingConsumers;
+        bool ready = m_consumerCond.wait_for(lock, waitDuration, [this]() { return m_count > 0; });
+        --m_waitingConsumers;
+        return ready;
+    }
+
+    // 持有 m_mutex 时调用,返回前释放锁
+    size_t popBulk(std::unique_lock<std::mutex>& lock, std::vector<AsyncMsg>& items, size_t maxItems)
+    {
+        size_t count = 0;
+        while (count < maxItems && m_count > 0)
+        {
+            items.push_back(readFront());
+            popRecord();
+            ++count;
+        }
+        if (count > 0)
+        {
+            notifyProducers(lock);
+        }
+        return count;
+    }
+
+    // 持有 m_mutex 时调用,返回前释放锁
+    // 记录长度不一,腾出的空间可能够多个生产者使用,因此唤醒全部
+    void notifyProducers(std::unique_lock<std::mutex>& lock)
+    {
+        bool wakeProducers = m_waitingProducers > 0;
+        lock.unlock();
+        if (wakeProducers)
+        {
+            m_producerCond.notify_all();
+        }
+    }
+
+    const size_t m_capacity;
+    std::unique_ptr<unsigned char[]> m_buffer;
+
+    // 以下状态受 m_mutex 保护
+    size_t m_head{0};
+    size_t m_tail{0};
+    size_t m_wrapEnd{0};
+    bool m_wrapped{false};
+    size_t m_count{0};
+    size_t m_usedBytes{0};
+    std::atomic<size_t> m_overrunCount{0};
+    size_t m_waitingConsumers{0};
+    size_t m_waitingProducers{0};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_producerCond;
+    std::condition_variable m_consumerCond;
+    std::atomic<size_t> m_approxCount{0};  // 记录条数快照,可以不加锁读取
+    std::atomic<size_t> m_approxUsedBytes{0};  // 已占用字节数快照,丢弃模式据此免锁判断环已满
+};
+
+}
+}
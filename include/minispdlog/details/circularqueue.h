@@ -44,6 +44,15 @@ public:
         m_head = (m_head + 1) % m_capacity;
     }
 
+    //淘汰队头:取出并计入溢出次数,调用方在覆盖写入之前腾出位置
+    T evictFront()
+    {
+        T item = std::move(front());
+        popFront();
+        ++overrunCount;
+        return item;
+    }
+
     bool empty() const
     {
         return m_head == m_tail;
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "minispdlog/common.h"
+#include <fmt/format.h>
+#include <type_traits>
+#include <string>
+#include <tuple>
+#include <cstring>
+#include <cstdint>
+
+namespace minispdlog {
+namespace details {
+
+// 延迟格式化:生产者线程只把格式串和参数按值序列化,由后台工作线程执行 fmt 格式化
+//
+// 序列化布局: [格式串长度 u32][格式串][参数 0][参数 1]...
+//   - 算术类型(含 bool/char): 直接按字节拷贝
+//   - 字符串(const char* / std::string / std::string_view / 字符数组): [长度 u32][字节]
+//   - 格式串同样按值拷贝,fmt::runtime 传入的临时字符串也是安全的
+//
+// 其他类型可能引用调用方的状态,不支持延迟,Logger 会自动回退为立即格式化
+
+// 单个参数的编解码,capturable 为 false 的类型不能延迟格式化
+template<typename T, typename = void>
+struct DeferredArg
+{
+    static constexpr bool capturable = false;
+};
+
+template<typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+{
+    static constexpr bool capturable = true;
+    using Decoded = T;
+
+    static size_t size(T)
+    {
+        return sizeof(T);
+    }
+
+    static char* encode(char* dest, T value)
+    {
+        std::memcpy(dest, &value, sizeof(T));
+        return dest + sizeof(T);
+    }
+
+    static T decode(const char*& src)
+    {
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+        src += sizeof(T);
+        return value;
+    }
+};
+
+struct DeferredStringArg
+{
+    static constexpr bool capturable = true;
+    using Decoded = StringView;
+
+    static size_t size(StringView str)
+    {
+        return sizeof(uint32_t) + str.size();
+    }
+
+    static char* encode(char* dest, StringView str)
+    {
+        uint32_t length = static_cast<uint32_t>(str.size());
+        std::memcpy(dest, &length, sizeof(length));
+        if (length > 0)
+        {
+            std::memcpy(dest + sizeof(length), str.data(), length);
+        }
+        return dest + sizeof(length) + length;
+    }
+
+    static StringView decode(const char*& src)
+    {
+        uint32_t length;
+        std::memcpy(&length, src, sizeof(length));
+        StringView str(src + sizeof(length), length);
+        src += sizeof(length) + length;
+        return str;
+    }
+
+    // 空指针按空字符串处理
+    static size_t size(const char* str)
+    {
+        return size(str ? StringView(str) : StringView());
+    }
+
+    static char* encode(char* dest, const char* str)
+    {
+        return encode(dest, str ? StringView(str) : StringView());
+    }
+};
+
+template<> struct DeferredArg<std::string> : DeferredStringArg {};
+template<> struct DeferredArg<StringView> : DeferredStringArg {};
+template<> struct DeferredArg<const char*> : DeferredStringArg {};
+template<> struct DeferredArg<char*> : DeferredStringArg {};
+
+// 一组参数的编解码;Args 为 decay 之后的类型
+template<typename... Args>
+struct DeferredArgs
+{
+    static constexpr bool capturable = (DeferredArg<Args>::capturable && ...);
+
+    static size_t encodedSize(StringView formatStr, const Args&... args)
+    {
+        return DeferredStringArg::size(formatStr) + (size_t(0) + ... + DeferredArg<Args>::size(args));
+    }
+
+    // dest 至少要有 encodedSize() 字节
+    static void encode(char* dest, StringView formatStr, const Args&... args)
+    {
+        dest = DeferredStringArg::encode(dest, formatStr);
+        ((dest = DeferredArg<Args>::encode(dest, args)), ...);
+    }
+
+    // 工作线程调用:解码参数并把格式化结果追加到 out
+    static void format(StringView encoded, fmt::memory_buffer& out)
+    {
+        const char* src = encoded.data();
+        StringView formatStr = DeferredStringArg::decode(src);
+        // 花括号初始化保证参数按从左到右的顺序解码
+        std::tuple<typename DeferredArg<Args>::Decoded...> values{DeferredArg<Args>::decode(src)...};
+        try
+        {
+            std::apply([&](auto&... decoded) {
+                fmt::vformat_to(fmt::appender(out), fmt::string_view(formatStr.data(), formatStr.size()),
+                    fmt::make_format_args(decoded...));
+            }, values);
+        }
+        catch (const fmt::format_error& e)
+        {
+            // 解码后的类型与调用点不完全一致(例如 C 字符串的 {:p}),格式化失败时输出错误信息
+            fmt::format_to(fmt::appender(out), "[deferred format error: {}] {}", e.what(), formatStr);
+        }
+    }
+};
+
+}
+}
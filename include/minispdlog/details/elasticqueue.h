@@ -0,0 +1,438 @@
+#pragma once
+
+#include "asyncqueue.h"
+#include "asyncmsg.h"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace minispdlog {
+namespace details {
+
+// MemoryBudget: 多个 ElasticQueue 共用的内存预算(字节)
+// 预留/归还都是无锁的原子操作,各队列在自己的锁内调用
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(size_t limitBytes)
+        : m_limit(limitBytes) {}
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // 预算足够时占用 bytes 并返回 true
+    bool tryReserve(size_t bytes)
+    {
+        size_t used = m_used.load(std::memory_order_relaxed);
+        do
+        {
+            if (bytes > m_limit || used > m_limit - bytes)
+            {
+                return false;
+            }
+        } while (!m_used.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    // 不检查上限直接占用(空队列总能容纳一条消息)
+    void forceReserve(size_t bytes)
+    {
+        m_used.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void release(size_t bytes)
+    {
+        m_used.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t used() const
+    {
+        return m_used.load(std::memory_order_relaxed);
+    }
+
+    size_t limit() const
+    {
+        return m_limit;
+    }
+
+private:
+    const size_t m_limit;
+    std::atomic<size_t> m_used{0};
+};
+
+// ElasticQueue: 按块增长的弹性队列
+//   - 消息存放在固定条数的块中,起始只有一个常驻块,积压时逐块分配,消费完的块随即释放
+//   - 块的内存(条数 * sizeof(AsyncMsg))与溢出到堆上的 payload 字节都从 MemoryBudget 中预留,
+//     预算用尽才算"队列满",此时才按阻塞/覆盖/丢弃处理
+//   - 最多缓存一个空闲块,避免积压跨越块边界时反复分配;队列取空时连同缓存块一起释放,
+//     空闲时只占用一个常驻块
+//   - 空队列总能接收一条消息,即使它的 payload 超出剩余预算,超大的单条消息不会让生产者永远等待
+//   - 出队时移走的消息与消费方交换堆缓冲区,留在空槽位中的缓冲区不计入预算,随块释放
+//
+// 多个队列共用一个预算时,一个队列释放的预算不会唤醒另一个队列上等待的生产者,
+// 等待方按 BUDGET_POLL 的间隔重新检查
+class ElasticQueue : public AsyncQueue<AsyncMsg>
+{
+public:
+    ElasticQueue(size_t chunkSize, std::shared_ptr<MemoryBudget> budget)
+        : m_chunkSize(chunkSize),
+          m_chunkBytes(chunkSize * sizeof(AsyncMsg)),
+          m_budget(std::move(budget))
+    {
+        if (m_chunkSize == 0)
+        {
+            throw std::invalid_argument("ElasticQueue chunk size must be greater than 0");
+        }
+        if (!m_budget->tryReserve(m_chunkBytes))
+        {
+            throw std::invalid_argument("ElasticQueue memory budget is too small for one chunk");
+        }
+        m_reservedBytes = m_chunkBytes;
+        m_chunks.push_back(std::make_unique<Chunk>(m_chunkSize));
+    }
+
+    ElasticQueue(const ElasticQueue&) = delete;
+    ElasticQueue& operator=(const ElasticQueue&) = delete;
+
+    ~ElasticQueue() override
+    {
+        // 残留消息随块一起析构(未完成的 Barrier 会在此通知投递方)
+        m_budget->release(m_reservedBytes);
+    }
+
+    //入队(阻塞模式):预算用尽时等待消费者释放
+    void enqueue(AsyncMsg&& item) override
+    {
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!tryPush(item))
+            {
+                ++m_waitingProducers;
+                while (!tryPush(item))
+                {
+                    m_producerCond.wait_for(lock, BUDGET_POLL);
+                }
+                --m_waitingProducers;
+            }
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+    }
+
+    //入队(非阻塞模式):预算用尽时淘汰最旧的消息直到放得下
+    void enqueueNoWait(AsyncMsg&& item) override
+    {
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!tryPush(item))
+            {
+                // 预算被其他队列占满时,本队列淘汰到空为止,之后 tryPush 一定成功
+                AsyncMsg oldest;
+                popFront(oldest);
+                m_overrunCount.fetch_add(1, std::memory_order_relaxed);
+                evicted(oldest);
+            }
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+    }
+
+    bool tryEnqueue(AsyncMsg&& item) override
+    {
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!tryPush(item))
+            {
+                return false;
+            }
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+        return true;
+    }
+
+    bool enqueueFor(AsyncMsg&& item, std::chrono::milliseconds waitDuration) override
+    {
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!tryPush(item))
+            {
+                auto deadline = std::chrono::steady_clock::now() + waitDuration;
+                ++m_waitingProducers;
+                bool pushed = false;
+                while (!pushed)
+                {
+                    auto now = std::chrono::steady_clock::now();
+                    if (now >= deadline)
+                    {
+                        break;
+                    }
+                    auto slice = std::min<std::chrono::steady_clock::duration>(deadline - now, BUDGET_POLL);
+                    m_producerCond.wait_for(lock, slice);
+                    pushed = tryPush(item);
+                }
+                --m_waitingProducers;
+                if (!pushed)
+                {
+                    return false; //等待超时
+                }
+            }
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
+        }
+        return true;
+    }
+
+    bool dequeueFor(AsyncMsg& item, std::chrono::milliseconds waitDuration) override
+    {
+        bool wakeProducer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!waitNotEmpty(lock, waitDuration))
+            {
+                return false; //等待超时
+            }
+            popFront(item);
+            wakeProducer = m_waitingProducers > 0;
+        }
+        if (wakeProducer)
+        {
+            m_producerCond.notify_one();
+        }
+        return true;
+    }
+
+    bool tryDequeue(AsyncMsg& item) override
+    {
+        bool wakeProducer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_count == 0)
+            {
+                return false;
+            }
+            popFront(item);
+            wakeProducer = m_waitingProducers > 0;
+        }
+        if (wakeProducer)
+        {
+            m_producerCond.notify_one();
+        }
+        return true;
+    }
+
+    //批量出队:一次加锁取出多条消息
+    size_t dequeueBulkFor(std::vector<AsyncMsg>& items, size_t maxItems, std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!waitNotEmpty(lock, waitDuration))
+        {
+            return 0; //等待超时
+        }
+        return popBulk(lock, items, maxItems);
+    }
+
+    bool waitForData(std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return waitNotEmpty(lock, waitDuration);
+    }
+
+    size_t tryDequeueBulk(std::vector<AsyncMsg>& items, size_t maxItems) override
+    {
+        // 空队列时不碰互斥锁
+        if (m_approxSize.load(std::memory_order_relaxed) == 0)
+        {
+            return 0;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return popBulk(lock, items, maxItems);
+    }
+
+    size_t overrunCount() override
+    {
+        return m_overrunCount.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
+    }
+
+    // 本队列从预算中占用的字节数(已分配的块 + 堆上的 payload)
+    size_t reservedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reservedBytes;
+    }
+
+    // 已分配的块数(含缓存的空闲块)
+    size_t chunkCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_chunks.size() + (m_spare ? 1 : 0);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds BUDGET_POLL{1};
+
+    struct Chunk
+    {
+        explicit Chunk(size_t size)
+            : m_slots(new AsyncMsg[size]) {}
+
+        std::unique_ptr<AsyncMsg[]> m_slots;
+        size_t m_head{0};
+        size_t m_tail{0};
+    };
+
+    // 计入预算的 payload 字节:内联的 payload 已包含在块的大小中
+    static size_t payloadCost(const AsyncMsg& item)
+    {
+        return item.payloadInline() ? 0 : item.m_payload.size();
+    }
+
+    // 持有 m_mutex 时调用;预算不足时返回 false,item 保持原样
+    bool tryPush(AsyncMsg& item)
+    {
+        size_t cost = payloadCost(item);
+        bool needChunk = m_chunks.back()->m_tail == m_chunkSize && !m_spare;
+        size_t bytes = cost + (needChunk ? m_chunkBytes : 0);
+        if (m_count == 0)
+        {
+            // 空队列的尾块一定有空位,只可能超出 payload 的预算
+            m_budget->forceReserve(bytes);
+        }
+        else if (!m_budget->tryReserve(bytes))
+        {
+            return false;
+        }
+        m_reservedBytes += bytes;
+
+        if (m_chunks.back()->m_tail == m_chunkSize)
+        {
+            m_chunks.push_back(m_spare ? std::move(m_spare) : std::make_unique<Chunk>(m_chunkSize));
+        }
+        Chunk& tail = *m_chunks.back();
+        tail.m_slots[tail.m_tail++] = std::move(item);
+        ++m_count;
+        m_approxSize.store(m_count, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 持有 m_mutex 且队列非空时调用
+    void popFront(AsyncMsg& item)
+    {
+        Chunk& head = *m_chunks.front();
+        item = std::move(head.m_slots[head.m_head++]);
+        size_t released = payloadCost(item);
+        --m_count;
+
+        if (head.m_head == head.m_tail)
+        {
+            if (m_chunks.size() > 1)
+            {
+                // 非尾块一定是满的,取完即可回收
+                std::unique_ptr<Chunk> drained = std::move(m_chunks.front());
+                m_chunks.pop_front();
+                if (!m_spare)
+                {
+                    drained->m_head = 0;
+                    drained->m_tail = 0;
+                    m_spare = std::move(drained);
+                }
+                else
+                {
+                    released += m_chunkBytes;
+                }
+            }
+            else
+            {
+                // 取空了:常驻块从头复用,缓存块也一并释放
+                head.m_head = 0;
+                head.m_tail = 0;
+                if (m_spare)
+                {
+                    m_spare.reset();
+                    released += m_chunkBytes;
+                }
+            }
+        }
+
+        m_reservedBytes -= released;
+        m_budget->release(released);
+        m_approxSize.store(m_count, std::memory_order_relaxed);
+    }
+
+    // 持有 m_mutex 时调用;等待期间登记为挂起的消费者
+    bool waitNotEmpty(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds waitDuration)
+    {
+        if (m_count > 0)
+        {
+            return true;
+        }
+        ++m_waitingConsumers;
+        bool ready = m_consumerCond.wait_for(lock, waitDuration, [this]() { return m_count > 0; });
+        --m_waitingConsumers;
+        return ready;
+    }
+
+    // 持有 m_mutex 时调用,返回前释放锁
+    size_t popBulk(std::unique_lock<std::mutex>& lock, std::vector<AsyncMsg>& items, size_t maxItems)
+    {
+        size_t count = 0;
+        while (count < maxItems && m_count > 0)
+        {
+            items.emplace_back();
+            popFront(items.back());
+            ++count;
+        }
+        bool wakeProducers = count > 0 && m_waitingProducers > 0;
+        lock.unlock();
+        if (wakeProducers)
+        {
+            m_producerCond.notify_all(); //腾出了预算,唤醒所有等待的生产者
+        }
+        return count;
+    }
+
+    const size_t m_chunkSize;
+    const size_t m_chunkBytes;
+    std::shared_ptr<MemoryBudget> m_budget;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_producerCond;
+    std::condition_variable m_consumerCond;
+    std::deque<std::unique_ptr<Chunk>> m_chunks;    // 从队头到队尾,至少有一个
+    std::unique_ptr<Chunk> m_spare;                 // 缓存的空闲块
+    size_t m_count{0};
+    size_t m_reservedBytes{0};      // 本队列占用的预算,析构时归还
+    std::atomic<size_t> m_approxSize{0};  // 队列长度快照,可以不加锁读取
+    std::atomic<size_t> m_overrunCount{0};
+    size_t m_waitingConsumers{0};   // 挂起的消费者数量(受 m_mutex 保护)
+    size_t m_waitingProducers{0};   // 挂起的生产者数量(受 m_mutex 保护)
+};
+
+}
+}
@@ -0,0 +1,449 @@
+#pragma once
+
+#include "minispdlog/common.h"
+#include "asyncqueue.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace minispdlog {
+namespace details {
+
+// CPU 自旋等待提示,降低自旋时的功耗与流水线冲刷
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// LockFreeMPMCQueue: 无锁有界 MPMC 环形队列
+// 参考 Dmitry Vyukov 的 bounded MPMC queue 设计:
+//   - 每个槽位带一个序列号,生产者/消费者通过 CAS 抢占位置
+//   - head/tail 各占一条缓存行,避免生产者与消费者之间的伪共享
+//   - 槽位数向上取整为 2 的幂(内存按取整后的槽位数分配),但最多只容纳 capacity 条数据,
+//     满/覆盖的边界与 MPMCBlockingQueue 相同;capacity 本身是 2 的幂时没有额外的检查
+//
+// 队列为空/满时的等待:
+//   - 先自旋,再挂起到条件变量上
+//   - 只有存在等待者时对端才会加锁唤醒,快路径上不碰互斥锁
+template <typename T>
+class LockFreeMPMCQueue : public AsyncQueue<T>
+{
+public:
+    explicit LockFreeMPMCQueue(size_t capacity)
+        : m_limit(capacity < 2 ? 2 : capacity),
+          m_capacity(roundUpPow2(m_limit)),
+          m_mask(m_capacity - 1),
+          m_cells(new Cell[m_capacity])
+    {
+        for (size_t i = 0; i < m_capacity; ++i)
+        {
+            m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeMPMCQueue(const LockFreeMPMCQueue&) = delete;
+    LockFreeMPMCQueue& operator=(const LockFreeMPMCQueue&) = delete;
+
+    //入队(阻塞模式):队列满时等待消费者腾出空间
+    void enqueue(T&& item) override
+    {
+        if (tryPush(std::move(item)))
+        {
+            notifyConsumer();
+            return;
+        }
+
+        while (true)
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                if (tryPush(std::move(item)))
+                {
+                    notifyConsumer();
+                    return;
+                }
+                cpuRelax();
+            }
+
+            m_producerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_producerCond.wait_for(lock, PARK_INTERVAL, [this]() { return !full(); });
+            }
+            m_producerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    //入队(非阻塞模式):队列满时丢弃最旧的数据
+    //出队与调用淘汰处理器之间计入 m_evicting,等待方据此知道被淘汰的数据是否已经处理完
+    void enqueueNoWait(T&& item) override
+    {
+        while (!tryPush(std::move(item)))
+        {
+            m_evicting.fetch_add(1, std::memory_order_seq_cst);
+            {
+                T oldest;
+                if (tryPop(oldest))
+                {
+                    m_overrunCount.fetch_add(1, std::memory_order_relaxed);
+                    this->evicted(oldest);
+                }
+            }
+            m_evicting.fetch_sub(1, std::memory_order_release);
+        }
+        notifyConsumer();
+    }
+
+    //入队(丢弃模式):队列满时直接返回 false,整个过程无锁
+    bool tryEnqueue(T&& item) override
+    {
+        if (!tryPush(std::move(item)))
+        {
+            return false;
+        }
+        notifyConsumer();
+        return true;
+    }
+
+    bool enqueueFor(T&& item, std::chrono::milliseconds waitDuration) override
+    {
+        if (tryPush(std::move(item)))
+        {
+            notifyConsumer();
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        while (true)
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                if (tryPush(std::move(item)))
+                {
+                    notifyConsumer();
+                    return true;
+                }
+                cpuRelax();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                return false; //等待超时
+            }
+            m_producerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                auto wakeAt = std::min(deadline, now + PARK_INTERVAL);
+                m_producerCond.wait_until(lock, wakeAt, [this]() { return !full(); });
+            }
+            m_producerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool dequeueFor(T& item, std::chrono::milliseconds waitDuration) override
+    {
+        if (tryPop(item))
+        {
+            notifyProducer();
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        while (true)
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                if (tryPop(item))
+                {
+                    notifyProducer();
+                    return true;
+                }
+                cpuRelax();
+            }
+
+            m_consumerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            bool timeout;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                timeout = !m_consumerCond.wait_until(lock, deadline, [this]() { return !empty(); });
+            }
+            m_consumerWaiting.fetch_sub(1, std::memory_order_relaxed);
+
+            if (tryPop(item))
+            {
+                notifyProducer();
+                return true;
+            }
+            if (timeout)
+            {
+                return false; //等待超时
+            }
+        }
+    }
+
+    //不自旋,直接挂起:调用方(工作线程)在此之前已经按等待策略自旋过
+    bool waitForData(std::chrono::milliseconds waitDuration) override
+    {
+        if (!empty())
+        {
+            return true;
+        }
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        m_consumerWaiting.fetch_add(1, std::memory_order_seq_cst);
+        bool ready;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ready = m_consumerCond.wait_until(lock, deadline, [this]() { return !empty(); });
+        }
+        m_consumerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        return ready;
+    }
+
+    bool approxFull() override
+    {
+        return full();
+    }
+
+    size_t evictionsInFlight() const override
+    {
+        return m_evicting.load(std::memory_order_acquire);
+    }
+
+    size_t overrunCount() override
+    {
+        return m_overrunCount.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const override
+    {
+        size_t tail = m_enqueuePos.load(std::memory_order_acquire);
+        size_t head = m_dequeuePos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_limit;
+    }
+
+    bool tryDequeue(T& item) override
+    {
+        if (!tryPop(item))
+        {
+            return false;
+        }
+        notifyProducer();
+        return true;
+    }
+
+    size_t tryDequeueBulk(std::vector<T>& items, size_t maxItems) override
+    {
+        size_t count = 0;
+        T item;
+        while (count < maxItems && tryPop(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        if (count > 0)
+        {
+            notifyProducer();
+        }
+        return count;
+    }
+
+    size_t dequeueBulkFor(std::vector<T>& items, size_t maxItems, std::chrono::milliseconds waitDuration) override
+    {
+        if (maxItems == 0)
+        {
+            return 0;
+        }
+
+        T item;
+        if (!dequeueFor(item, waitDuration))
+        {
+            return 0;
+        }
+        items.push_back(std::move(item));
+
+        size_t count = 1;
+        while (count < maxItems && tryPop(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        notifyProducer();
+        return count;
+    }
+
+private:
+    // 不唤醒消费者的入队原语,失败时 item 保持不变
+    bool tryPush(T&& item)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (overLimit(pos))
+                {
+                    return false; //达到容量上限
+                }
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; //队列已满
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->m_data = std::move(item);
+        cell->m_sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    struct Cell
+    {
+        std::atomic<size_t> m_sequence{0};
+        T m_data;
+    };
+
+    // 不唤醒生产者的出队原语
+    bool tryPop(T& item)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                // 成功时 acq_rel:先后出队的消费者之间建立 happens-before,
+                // 后取到 Barrier/Flush 的线程能看到更早出队线程在出队之前写下的状态(线程池的处理纪元)
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; //队列为空
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(cell->m_data);
+        cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr int SPIN_COUNT = 64;
+    static constexpr std::chrono::milliseconds PARK_INTERVAL{1};
+
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // 队头槽位已发布数据
+    bool empty() const
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_acquire);
+        return m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    // 槽位数多于容量时,入队位置领先出队位置 m_limit 即视为已满
+    // 读到的出队位置可能落后,只会把队列判为满,不会超出容量
+    bool overLimit(size_t pos) const
+    {
+        if (m_limit == m_capacity)
+        {
+            return false;
+        }
+        size_t head = m_dequeuePos.load(std::memory_order_acquire);
+        return static_cast<intptr_t>(pos - head) >= static_cast<intptr_t>(m_limit);
+    }
+
+    // 队尾槽位尚未被消费者释放,或已达到容量上限
+    bool full() const
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_acquire);
+        return m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire) != pos || overLimit(pos);
+    }
+
+    // 与等待方的 fetch_add 配对,保证"发布数据"与"检查等待者"不会同时错过
+    void notifyConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_consumerCond.notify_one();
+        }
+    }
+
+    void notifyProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producerWaiting.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_producerCond.notify_one();
+        }
+    }
+
+    const size_t m_limit;       // 最多容纳的数据条数
+    const size_t m_capacity;    // 槽位数,m_limit 向上取整为 2 的幂
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueuePos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeuePos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_overrunCount{0};
+    std::atomic<size_t> m_evicting{0};
+    std::atomic<int> m_consumerWaiting{0};
+    std::atomic<int> m_producerWaiting{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_consumerCond;
+    std::condition_variable m_producerCond;
+};
+
+}
+}
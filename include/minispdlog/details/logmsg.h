@@ -3,8 +3,10 @@
 #include "../common.h"
 #include "../level.h"
 #include "utils.h"
+#include <fmt/format.h>
 #include <string>
 #include <cstddef>
+#include <vector>
 
 namespace minispdlog {
 namespace details{
@@ -22,7 +24,10 @@ struct SourceLocation
     int m_line{0};
     const char* m_functionName{nullptr};
 };
-    
+
+// 延迟格式化的消息由该函数把序列化的参数格式化为文本(见 deferredformat.h)
+using FormatArgsFn = void (*)(StringView encodedArgs, fmt::memory_buffer& out);
+
 struct LogMsg
 {
     LogMsg() = default;
@@ -82,7 +87,14 @@ struct LogMsg
     size_t m_threadId{0};
     SourceLocation m_sourceLocation;
     StringView m_payload;
+    // 非空时 m_payload 保存的是序列化的格式串与参数,输出前必须先调用它格式化
+    FormatArgsFn m_formatArgs{nullptr};
+    // 投递顺序号:线程池启用优先通道时分配,消息可能不按投递顺序写出,用它还原全局顺序(%N)
+    uint64_t m_sequence{0};
 };
 
+// 一批待输出的日志消息(异步线程批量分发给 sink)
+using LogMsgBatch = std::vector<const LogMsg*>;
+
 }
 }
\ No newline at end of file
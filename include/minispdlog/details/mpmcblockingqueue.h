@@ -1,75 +1,250 @@
 #pragma once
 
+#include "asyncqueue.h"
 #include "circularqueue.h"
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <vector>
+#include <atomic>
 
 namespace minispdlog {
 namespace details {
 
 template <typename T>
-class MPMCBlockingQueue
+class MPMCBlockingQueue : public AsyncQueue<T>
 {
 public:
     explicit MPMCBlockingQueue(size_t capacity)
-        : m_queue(capacity) {}
+        : m_capacity(capacity), m_queue(capacity) {}
 
     MPMCBlockingQueue(const MPMCBlockingQueue&) = delete;
     MPMCBlockingQueue& operator=(const MPMCBlockingQueue&) = delete;
 
     //入队(阻塞模式):队列满时阻塞等待
-    void enqueue(T&& item)
+    //只有存在挂起的消费者时才 notify,消费者醒着时省掉唤醒开销
+    void enqueue(T&& item) override
     {
+        bool wakeConsumer;
         {
             std::unique_lock<std::mutex> lock(m_mutex);
-            m_producerCond.wait(lock, [this]() { return !m_queue.full(); });
+            if (m_queue.full())
+            {
+                ++m_waitingProducers;
+                m_producerCond.wait(lock, [this]() { return !m_queue.full(); });
+                --m_waitingProducers;
+            }
+            m_queue.pushBack(std::move(item));
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one(); //通知一个等待的消费者线程
+        }
+    }
+
+    void enqueueNoWait(T&& item) override
+    {
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.full())
+            {
+                T oldest = m_queue.evictFront();
+                this->evicted(oldest);
+            }
+            m_queue.pushBack(std::move(item));
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            m_approxOverrun.store(m_queue.overrunCountValue(), std::memory_order_relaxed);
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one(); //通知一个等待的消费者线程
+        }
+    }
+
+    //队列明显已满时不碰互斥锁,直接放弃
+    bool tryEnqueue(T&& item) override
+    {
+        if (m_approxSize.load(std::memory_order_relaxed) >= m_capacity)
+        {
+            return false;
+        }
+        bool wakeConsumer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.full())
+            {
+                return false;
+            }
             m_queue.pushBack(std::move(item));
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
         }
-        m_consumerCond.notify_one(); //通知一个等待的消费者线程
+        return true;
     }
 
-    void enqueueNoWait(T&& item)
+    bool enqueueFor(T&& item, std::chrono::milliseconds waitDuration) override
     {
+        bool wakeConsumer;
         {
             std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.full())
+            {
+                ++m_waitingProducers;
+                bool ready = m_producerCond.wait_for(lock, waitDuration, [this]() { return !m_queue.full(); });
+                --m_waitingProducers;
+                if (!ready)
+                {
+                    return false; //等待超时
+                }
+            }
             m_queue.pushBack(std::move(item));
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            wakeConsumer = m_waitingConsumers > 0;
+        }
+        if (wakeConsumer)
+        {
+            m_consumerCond.notify_one();
         }
-        m_consumerCond.notify_one(); //通知一个等待的消费者线程
+        return true;
     }
 
-    bool dequeueFor(T& item, std::chrono::milliseconds waitDuration)
+    bool dequeueFor(T& item, std::chrono::milliseconds waitDuration) override
     {
+        bool wakeProducer;
         {
             std::unique_lock<std::mutex> lock(m_mutex);
-            if (!m_consumerCond.wait_for(lock, waitDuration, [this]() { return !m_queue.empty(); }))
+            if (!waitNotEmpty(lock, waitDuration))
             {
                 return false; //等待超时
             }
             item = std::move(m_queue.front());
             m_queue.popFront();
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            wakeProducer = m_waitingProducers > 0;
+        }
+        if (wakeProducer)
+        {
+            m_producerCond.notify_one(); //通知一个等待的生产者线程
         }
-        m_producerCond.notify_one(); //通知一个等待的生产者线程
         return true;
     }
 
-    size_t overrunCount()
+    bool tryDequeue(T& item) override
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_queue.overrunCountValue();
+        bool wakeProducer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.empty())
+            {
+                return false;
+            }
+            item = std::move(m_queue.front());
+            m_queue.popFront();
+            m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+            wakeProducer = m_waitingProducers > 0;
+        }
+        if (wakeProducer)
+        {
+            m_producerCond.notify_one();
+        }
+        return true;
+    }
+
+    //批量出队:一次加锁取出多条消息
+    size_t dequeueBulkFor(std::vector<T>& items, size_t maxItems, std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!waitNotEmpty(lock, waitDuration))
+        {
+            return 0; //等待超时
+        }
+        return popBulk(lock, items, maxItems);
+    }
+
+    bool waitForData(std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return waitNotEmpty(lock, waitDuration);
+    }
+
+    size_t tryDequeueBulk(std::vector<T>& items, size_t maxItems) override
+    {
+        // 空队列时不碰互斥锁,工作线程忙等期间不会与生产者争锁
+        if (m_approxSize.load(std::memory_order_relaxed) == 0)
+        {
+            return 0;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return popBulk(lock, items, maxItems);
     }
 
-    size_t size() const
+    bool approxFull() override
+    {
+        return m_approxSize.load(std::memory_order_relaxed) >= m_capacity;
+    }
+
+    size_t overrunCount() override
+    {
+        return m_approxOverrun.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const override
     {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_queue.size();
     }
 
 private:
-    std::mutex m_mutex;
+    // 持有 m_mutex 时调用;等待期间登记为挂起的消费者
+    bool waitNotEmpty(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds waitDuration)
+    {
+        if (!m_queue.empty())
+        {
+            return true;
+        }
+        ++m_waitingConsumers;
+        bool ready = m_consumerCond.wait_for(lock, waitDuration, [this]() { return !m_queue.empty(); });
+        --m_waitingConsumers;
+        return ready;
+    }
+
+    // 持有 m_mutex 时调用,返回前释放锁
+    size_t popBulk(std::unique_lock<std::mutex>& lock, std::vector<T>& items, size_t maxItems)
+    {
+        size_t count = 0;
+        while (count < maxItems && !m_queue.empty())
+        {
+            items.push_back(std::move(m_queue.front()));
+            m_queue.popFront();
+            ++count;
+        }
+        m_approxSize.store(m_queue.size(), std::memory_order_relaxed);
+        bool wakeProducers = count > 0 && m_waitingProducers > 0;
+        lock.unlock();
+        if (wakeProducers)
+        {
+            m_producerCond.notify_all(); //腾出了多个位置,唤醒所有等待的生产者
+        }
+        return count;
+    }
+
+    const size_t m_capacity;
+    mutable std::mutex m_mutex;
     std::condition_variable m_producerCond;
     std::condition_variable m_consumerCond;
     CircularQueue<T> m_queue;
+    std::atomic<size_t> m_approxSize{0};  // 队列长度快照,可以不加锁读取
+    std::atomic<size_t> m_approxOverrun{0};  // 覆盖计数快照,只在覆盖入队时更新
+    size_t m_waitingConsumers{0};   // 挂起的消费者数量(受 m_mutex 保护)
+    size_t m_waitingProducers{0};   // 挂起的生产者数量(受 m_mutex 保护)
 };
 
 }
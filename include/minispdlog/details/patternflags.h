@@ -0,0 +1,351 @@
+#pragma once
+
+#include "logmsg.h"
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+#include <chrono>
+
+namespace minispdlog {
+namespace details {
+
+// 各占位符的输出实现
+// PatternFormatter 与 StaticPatternFormatter 共用,保证两者的输出逐字节一致
+namespace flags {
+
+inline constexpr char DIGITS_TABLE[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+inline void appendTwoDigits(uint32_t n, fmt::memory_buffer& dest)
+{
+    const char* d = n < 100 ? DIGITS_TABLE + n * 2 : "00";
+    dest.append(d, d + 2);
+}
+
+// 定宽数字:不足位数补 0,调用方保证 n 不超过位数;除以常数由编译器换成乘法,没有分支和循环
+inline void writeFixed2(char* out, uint32_t n)
+{
+    std::memcpy(out, DIGITS_TABLE + n * 2, 2);
+}
+
+inline void writeFixed3(char* out, uint32_t n)
+{
+    uint32_t hi = n / 100;
+    out[0] = static_cast<char>('0' + hi);
+    writeFixed2(out + 1, n - hi * 100);
+}
+
+inline void writeFixed6(char* out, uint32_t n)
+{
+    uint32_t hi = n / 10000;
+    uint32_t lo = n - hi * 10000;
+    uint32_t mid = lo / 100;
+    writeFixed2(out, hi);
+    writeFixed2(out + 2, mid);
+    writeFixed2(out + 4, lo - mid * 100);
+}
+
+inline void writeFixed9(char* out, uint32_t n)
+{
+    uint32_t hi = n / 1000000;
+    writeFixed3(out, hi);
+    writeFixed6(out + 3, n - hi * 1000000);
+}
+
+inline void appendUint(uint64_t n, fmt::memory_buffer& dest)
+{
+    fmt::format_int str(n);
+    dest.append(str.data(), str.data() + str.size());
+}
+
+//%Y : 年份
+inline void year(const std::tm& time, fmt::memory_buffer& dest)
+{
+    char buffer[4];
+    int year = time.tm_year + 1900;
+    // 手动展开避免 sprintf 开销
+    buffer[0] = static_cast<char>('0' + (year / 1000));
+    buffer[1] = static_cast<char>('0' + ((year / 100) % 10));
+    buffer[2] = static_cast<char>('0' + ((year / 10) % 10));
+    buffer[3] = static_cast<char>('0' + (year % 10));
+    dest.append(buffer, buffer + 4);
+}
+
+//%m : 月份
+inline void month(const std::tm& time, fmt::memory_buffer& dest)
+{
+    appendTwoDigits(static_cast<uint32_t>(time.tm_mon + 1), dest);
+}
+
+//%d : 日期
+inline void day(const std::tm& time, fmt::memory_buffer& dest)
+{
+    appendTwoDigits(static_cast<uint32_t>(time.tm_mday), dest);
+}
+
+//%H : 小时
+inline void hour(const std::tm& time, fmt::memory_buffer& dest)
+{
+    appendTwoDigits(static_cast<uint32_t>(time.tm_hour), dest);
+}
+
+//%M : 分钟
+inline void minute(const std::tm& time, fmt::memory_buffer& dest)
+{
+    appendTwoDigits(static_cast<uint32_t>(time.tm_min), dest);
+}
+
+//%S : 秒
+inline void second(const std::tm& time, fmt::memory_buffer& dest)
+{
+    appendTwoDigits(static_cast<uint32_t>(time.tm_sec), dest);
+}
+
+//%z : 相对 UTC 的偏移(+08:00),offset 为秒数
+inline void utcOffset(int32_t offset, fmt::memory_buffer& dest)
+{
+    char buffer[6];
+    buffer[0] = offset < 0 ? '-' : '+';
+    uint32_t minutes = static_cast<uint32_t>(offset < 0 ? -offset : offset) / 60;
+    writeFixed2(buffer + 1, minutes / 60 % 100);
+    buffer[3] = ':';
+    writeFixed2(buffer + 4, minutes % 60);
+    dest.append(buffer, buffer + 6);
+}
+
+//%t : 线程ID
+inline void threadId(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    appendUint(static_cast<uint64_t>(msg.m_threadId), dest);
+}
+
+//%l : 日志级别(短格式 T D I W E C)
+inline void levelShort(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    static constexpr std::string_view levelStrings[] = {
+        "T", "D", "I", "W", "E", "C", "O"
+    };
+    auto levelStr = levelStrings[static_cast<size_t>(msg.m_level)];
+    dest.append(levelStr.data(), levelStr.data() + levelStr.size());
+}
+
+//%L : 日志级别(完整格式 trace debug info warning error critical)
+inline void levelFull(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    static constexpr std::string_view levelStrings[] = {
+        "trace", "debug", "info", "warning", "error", "critical", "off"
+    };
+    auto levelStr = levelStrings[static_cast<size_t>(msg.m_level)];
+    dest.append(levelStr.data(), levelStr.data() + levelStr.size());
+}
+
+//%n : logger名称
+inline void loggerName(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    dest.append(msg.m_loggerName.data(), msg.m_loggerName.data() + msg.m_loggerName.size());
+}
+
+//%v : 日志消息内容
+inline void payload(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    dest.append(msg.m_payload.data(), msg.m_payload.data() + msg.m_payload.size());
+}
+
+//%N : 投递顺序号
+inline void sequence(const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    appendUint(msg.m_sequence, dest);
+}
+
+// 时间戳秒以下的部分(纳秒,0 ~ 999999999)
+inline uint32_t subsecondNanos(const LogMsg& msg)
+{
+    auto sinceEpoch = msg.m_timePoint.time_since_epoch();
+    auto frac = sinceEpoch - std::chrono::floor<std::chrono::seconds>(sinceEpoch);
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(frac).count());
+}
+
+// 秒以下占位符的输出宽度
+constexpr size_t subsecondWidth(char flag)
+{
+    return flag == 'e' ? 3 : flag == 'f' ? 6 : 9;
+}
+
+// 把秒以下的部分按 flag 写成定宽数字(%e 毫秒 3 位,%f 微秒 6 位,%F 纳秒 9 位)
+inline void writeSubsecond(char flag, uint32_t nanos, char* out)
+{
+    switch (flag)
+    {
+        case 'e': writeFixed3(out, nanos / 1000000); break;
+        case 'f': writeFixed6(out, nanos / 1000); break;
+        default: writeFixed9(out, nanos); break;
+    }
+}
+
+//%e %f %F : 毫秒/微秒/纳秒
+inline void subsecond(char flag, const LogMsg& msg, fmt::memory_buffer& dest)
+{
+    size_t size = dest.size();
+    dest.resize(size + subsecondWidth(flag));
+    writeSubsecond(flag, subsecondNanos(msg), dest.data() + size);
+}
+
+//%o %i %u %O : 距上一条消息的时间(毫秒/微秒/纳秒/秒),elapsedNs 由格式化器计算
+inline void elapsed(char flag, int64_t elapsedNs, fmt::memory_buffer& dest)
+{
+    uint64_t ns = static_cast<uint64_t>(elapsedNs);
+    switch (flag)
+    {
+        case 'o': appendUint(ns / 1000000, dest); break;
+        case 'i': appendUint(ns / 1000, dest); break;
+        case 'u': appendUint(ns, dest); break;
+        default: appendUint(ns / 1000000000, dest); break;
+    }
+}
+
+// 对齐方式:Left 在左侧补空格(右对齐,"%8l"),Right 在右侧补空格("%-8l"),Center 两侧补空格("%=8l")
+enum class PadSide : uint8_t
+{
+    Left,
+    Right,
+    Center
+};
+
+// 占位符的宽度说明,m_width 为 0 表示不补齐;m_truncate("%8!l")表示超出宽度时截断
+struct PadSpec
+{
+    uint8_t m_width{0};
+    PadSide m_side{PadSide::Left};
+    bool m_truncate{false};
+};
+
+constexpr size_t MAX_PAD_WIDTH = 64;
+
+// 把 dest 中从 start 开始的输出补齐/截断到 pad.m_width
+inline void applyPadding(fmt::memory_buffer& dest, size_t start, const PadSpec& pad)
+{
+    size_t size = dest.size() - start;
+    size_t width = pad.m_width;
+    if (size >= width)
+    {
+        if (pad.m_truncate && size > width)
+        {
+            dest.resize(start + width);
+        }
+        return;
+    }
+
+    size_t fill = width - size;
+    size_t before = pad.m_side == PadSide::Left ? fill : pad.m_side == PadSide::Center ? fill / 2 : 0;
+    dest.resize(start + width);
+    char* data = dest.data() + start;
+    if (before > 0)
+    {
+        std::memmove(data + before, data, size);
+        std::memset(data, ' ', before);
+    }
+    std::memset(data + before + size, ' ', fill - before);
+}
+
+// 占位符是否需要日历时间(std::tm 与 UTC 偏移),这些字段每秒最多变化一次
+constexpr bool needsTime(char flag)
+{
+    return flag == 'Y' || flag == 'm' || flag == 'd' || flag == 'H' || flag == 'M' || flag == 'S' || flag == 'z';
+}
+
+// 秒以下的时间占位符:定宽,每条消息都不同
+constexpr bool isSubsecond(char flag)
+{
+    return flag == 'e' || flag == 'f' || flag == 'F';
+}
+
+// 距上一条消息的时间
+constexpr bool isElapsed(char flag)
+{
+    return flag == 'o' || flag == 'i' || flag == 'u' || flag == 'O';
+}
+
+// 是否为支持的占位符;不支持的 %x 按普通文本原样输出
+constexpr bool isKnown(char flag)
+{
+    return needsTime(flag) || isSubsecond(flag) || isElapsed(flag) ||
+        flag == 't' || flag == 'l' || flag == 'L' || flag == 'n' || flag == 'v' || flag == 'N';
+}
+
+// 解析 pattern,依次回调 emitter.text(ch) 与 emitter.flag(flag, pad)
+// PatternFormatter(运行期)与 StaticPatternFormatter(编译期)共用,两者的解析结果完全相同
+//   - "%%" 输出 '%'
+//   - 占位符可带宽度说明:%[-|=]<宽度>[!]<flag>,宽度最大 MAX_PAD_WIDTH
+//   - 不支持的占位符(含带宽度说明的 "%%")连同宽度说明原样输出,末尾不完整的占位符忽略
+template <typename Emitter>
+constexpr void parsePattern(const char* begin, const char* end, Emitter& emitter)
+{
+    const char* it = begin;
+    while (it != end)
+    {
+        if (*it != '%')
+        {
+            emitter.text(*it++);
+            continue;
+        }
+
+        const char* start = it++;
+        PadSpec pad;
+        if (it != end && (*it == '-' || *it == '='))
+        {
+            pad.m_side = *it == '-' ? PadSide::Right : PadSide::Center;
+            ++it;
+        }
+        size_t width = 0;
+        bool hasWidth = false;
+        while (it != end && *it >= '0' && *it <= '9')
+        {
+            width = width * 10 + static_cast<size_t>(*it - '0');
+            if (width > MAX_PAD_WIDTH)
+            {
+                width = MAX_PAD_WIDTH;
+            }
+            hasWidth = true;
+            ++it;
+        }
+        pad.m_width = static_cast<uint8_t>(width);
+        if (hasWidth && it != end && *it == '!')
+        {
+            pad.m_truncate = true;
+            ++it;
+        }
+        if (it == end)
+        {
+            break;
+        }
+
+        char flag = *it++;
+        bool plain = it - start == 2;
+        if (isKnown(flag))
+        {
+            emitter.flag(flag, pad);
+        }
+        else if (flag == '%' && plain)
+        {
+            emitter.text('%');
+        }
+        else
+        {
+            for (const char* ch = start; ch != it; ++ch)
+            {
+                emitter.text(*ch);
+            }
+        }
+    }
+}
+
+}
+
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace minispdlog {
+namespace details {
+
+// PeriodicWorker: 后台线程每隔 interval 调用一次 callback
+// 析构时立即唤醒并结束线程,不必等到下一个周期
+class PeriodicWorker
+{
+public:
+    PeriodicWorker(std::function<void()> callback, std::chrono::milliseconds interval);
+    ~PeriodicWorker();
+
+    PeriodicWorker(const PeriodicWorker&) = delete;
+    PeriodicWorker& operator=(const PeriodicWorker&) = delete;
+
+    std::chrono::milliseconds interval() const
+    {
+        return m_interval;
+    }
+
+private:
+    void loop();
+
+    std::function<void()> m_callback;
+    std::chrono::milliseconds m_interval;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_active{true};
+    std::thread m_thread;
+};
+
+}
+}
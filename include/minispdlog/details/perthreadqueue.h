@@ -0,0 +1,626 @@
+#pragma once
+
+#include "minispdlog/common.h"
+#include "asyncqueue.h"
+#include "spscqueue.h"
+#include "lockfreempmcqueue.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace minispdlog {
+namespace details {
+
+// 生产者线程退出时,其环形队列中尚未消费的消息如何处理
+enum class ProducerExitPolicy
+{
+    Drain,      // 继续消费完剩余消息后再回收
+    Discard     // 直接丢弃剩余消息(计入 overrunCount)
+};
+
+// PerThreadQueue: 每个生产者线程独占一个 SPSC 环形队列
+//   - 线程第一次入队时惰性创建自己的环形队列并注册到本队列
+//   - 生产者之间只共享一个入队编号计数器(每条消息一次 relaxed fetch_add),环形队列互不共享缓存行
+//   - 消费者每次比较所有环形队列当前的队头,取出入队编号最小的一条
+//   - 同一时刻只有一个消费者在归并(SPSC 约束)
+//
+// 顺序保证:
+//   - 同一生产者线程的消息严格按入队顺序输出
+//   - 一条消息入队完成之后才开始入队的消息(不论来自哪个生产者)一定排在它之后输出,
+//     Flush/Barrier 依赖这一点;编号在入队时领取,与墙上时钟无关,时钟回拨或共用后备环形队列时同样成立
+//   - 并发入队的消息之间没有确定的先后,输出顺序也不保证与 m_timePoint 一致
+//
+// 注意:非阻塞入队时生产者无法淘汰队头,队列满时丢弃的是新消息。
+template <typename T>
+class PerThreadQueue : public AsyncQueue<T>
+{
+public:
+    PerThreadQueue(size_t ringCapacity, ProducerExitPolicy exitPolicy)
+        : m_id(nextQueueId()),
+          m_ringCapacity(ringCapacity),
+          m_exitPolicy(exitPolicy),
+          m_fallbackRing(std::make_shared<Ring>(ringCapacity))
+    {
+        m_rings.push_back(m_fallbackRing);
+        m_ringsVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    ~PerThreadQueue() override
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (auto& ring : m_rings)
+        {
+            ring->m_orphaned.store(true, std::memory_order_release);
+        }
+    }
+
+    PerThreadQueue(const PerThreadQueue&) = delete;
+    PerThreadQueue& operator=(const PerThreadQueue&) = delete;
+
+    void enqueue(T&& item) override
+    {
+        Ring* ring = localRing();
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_fallbackMutex);
+            pushWait(*m_fallbackRing, item);
+        }
+        else
+        {
+            pushWait(*ring, item);
+        }
+        notifyConsumer();
+    }
+
+    void enqueueNoWait(T&& item) override
+    {
+        Ring* ring = localRing();
+        bool pushed;
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_fallbackMutex);
+            pushed = tryPush(*m_fallbackRing, item, nextTicket());
+        }
+        else
+        {
+            pushed = tryPush(*ring, item, nextTicket());
+        }
+
+        if (!pushed)
+        {
+            m_overrunCount.fetch_add(1, std::memory_order_relaxed);
+            this->evicted(item);
+            return;
+        }
+        notifyConsumer();
+    }
+
+    //入队(丢弃模式):本线程的环形队列满时直接返回 false,不计入 overrunCount
+    bool tryEnqueue(T&& item) override
+    {
+        Ring* ring = localRing();
+        bool pushed;
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_fallbackMutex);
+            pushed = tryPush(*m_fallbackRing, item, nextTicket());
+        }
+        else
+        {
+            pushed = tryPush(*ring, item, nextTicket());
+        }
+
+        if (pushed)
+        {
+            notifyConsumer();
+        }
+        return pushed;
+    }
+
+    bool enqueueFor(T&& item, std::chrono::milliseconds waitDuration) override
+    {
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        Ring* ring = localRing();
+        bool pushed;
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_fallbackMutex);
+            pushed = pushWaitUntil(*m_fallbackRing, item, deadline);
+        }
+        else
+        {
+            pushed = pushWaitUntil(*ring, item, deadline);
+        }
+
+        if (pushed)
+        {
+            notifyConsumer();
+        }
+        return pushed;
+    }
+
+    bool dequeueFor(T& item, std::chrono::milliseconds waitDuration) override
+    {
+        std::unique_lock<std::mutex> consumerLock(m_consumerMutex);
+        if (popEarliest(item))
+        {
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        while (true)
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                if (popEarliest(item))
+                {
+                    return true;
+                }
+                cpuRelax();
+            }
+
+            m_consumerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            bool timeout;
+            {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                timeout = !m_consumerCond.wait_until(lock, deadline, [this]() { return hasData(); });
+            }
+            m_consumerWaiting.fetch_sub(1, std::memory_order_relaxed);
+
+            if (popEarliest(item))
+            {
+                return true;
+            }
+            if (timeout)
+            {
+                return false; //等待超时
+            }
+        }
+    }
+
+    bool tryDequeue(T& item) override
+    {
+        std::lock_guard<std::mutex> consumerLock(m_consumerMutex);
+        return popEarliest(item);
+    }
+
+    size_t tryDequeueBulk(std::vector<T>& items, size_t maxItems) override
+    {
+        std::lock_guard<std::mutex> consumerLock(m_consumerMutex);
+        size_t count = 0;
+        T item;
+        while (count < maxItems && popEarliest(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    size_t dequeueBulkFor(std::vector<T>& items, size_t maxItems, std::chrono::milliseconds waitDuration) override
+    {
+        if (maxItems == 0)
+        {
+            return 0;
+        }
+
+        T item;
+        if (!dequeueFor(item, waitDuration))
+        {
+            return 0;
+        }
+        items.push_back(std::move(item));
+
+        std::lock_guard<std::mutex> consumerLock(m_consumerMutex);
+        size_t count = 1;
+        while (count < maxItems && popEarliest(item))
+        {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    //不自旋,直接挂起:调用方(工作线程)在此之前已经按等待策略自旋过
+    bool waitForData(std::chrono::milliseconds waitDuration) override
+    {
+        if (hasData())
+        {
+            return true;
+        }
+        auto deadline = std::chrono::steady_clock::now() + waitDuration;
+        m_consumerWaiting.fetch_add(1, std::memory_order_seq_cst);
+        bool ready;
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            ready = m_consumerCond.wait_until(lock, deadline, [this]() { return hasData(); });
+        }
+        m_consumerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        return ready;
+    }
+
+    //只检查本线程的环形队列;线程退出阶段使用后备队列时不做预检
+    bool approxFull() override
+    {
+        Ring* ring = localRing();
+        return ring != nullptr && ring->m_queue.size() >= ring->m_queue.capacity();
+    }
+
+    size_t overrunCount() override
+    {
+        return m_overrunCount.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const override
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        size_t total = 0;
+        for (auto& ring : m_rings)
+        {
+            total += ring->m_queue.size();
+        }
+        return total;
+    }
+
+    // 当前注册的生产者环形队列数量
+    size_t producerCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        return m_rings.size();
+    }
+
+private:
+    // 环形队列中的元素:入队编号 + 消息
+    struct Entry
+    {
+        uint64_t m_ticket{0};
+        T m_item;
+    };
+
+    struct Ring
+    {
+        explicit Ring(size_t capacity)
+            : m_queue(capacity)
+        {}
+
+        SPSCQueue<Entry> m_queue;
+        std::atomic<bool> m_closed{false};      // 生产者线程已退出
+        std::atomic<bool> m_orphaned{false};    // 所属队列已销毁
+    };
+
+    using RingPtr = std::shared_ptr<Ring>;
+
+    // 线程局部的环形队列表:线程退出时把自己的环形队列标记为关闭
+    struct LocalRings
+    {
+        struct Entry
+        {
+            uint64_t m_queueId;
+            RingPtr m_ring;
+        };
+
+        ~LocalRings()
+        {
+            for (auto& entry : m_entries)
+            {
+                entry.m_ring->m_closed.store(true, std::memory_order_release);
+            }
+            destroyed() = true;
+        }
+
+        // 平凡析构的线程局部标记:LocalRings 析构后仍可安全读取
+        static bool& destroyed()
+        {
+            thread_local bool flag = false;
+            return flag;
+        }
+
+        std::vector<Entry> m_entries;
+        uint64_t m_lastQueueId{0};
+        Ring* m_lastRing{nullptr};
+    };
+
+    static constexpr int SPIN_COUNT = 64;
+    static constexpr std::chrono::milliseconds PARK_INTERVAL{1};
+
+    static uint64_t nextQueueId()
+    {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    // 领取下一个入队编号;后备环形队列须在 m_fallbackMutex 内领取,保证编号在每个环形队列内递增
+    uint64_t nextTicket()
+    {
+        return m_nextTicket.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 原地写入环形队列的队尾,队列满时返回 false,item 保持原样
+    static bool tryPush(Ring& ring, T& item, uint64_t ticket)
+    {
+        Entry* slot = ring.m_queue.back();
+        if (slot == nullptr)
+        {
+            return false;
+        }
+        slot->m_ticket = ticket;
+        slot->m_item = std::move(item);
+        ring.m_queue.pushBack();
+        return true;
+    }
+
+    // 编号只在第一次尝试之前领取一次,等待后重试沿用同一个编号
+    void pushWait(Ring& ring, T& item)
+    {
+        uint64_t ticket = nextTicket();
+        while (!tryPush(ring, item, ticket))
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                cpuRelax();
+            }
+            m_producerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                m_producerCond.wait_for(lock, PARK_INTERVAL, [&ring]() {
+                    return ring.m_queue.size() < ring.m_queue.capacity();
+                });
+            }
+            m_producerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 与 pushWait 相同,但最多等待到 deadline,超时返回 false
+    bool pushWaitUntil(Ring& ring, T& item, std::chrono::steady_clock::time_point deadline)
+    {
+        uint64_t ticket = nextTicket();
+        while (!tryPush(ring, item, ticket))
+        {
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                cpuRelax();
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                return false;
+            }
+            m_producerWaiting.fetch_add(1, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                m_producerCond.wait_until(lock, std::min(deadline, now + PARK_INTERVAL), [&ring]() {
+                    return ring.m_queue.size() < ring.m_queue.capacity();
+                });
+            }
+            m_producerWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // 返回当前线程的环形队列;线程局部存储已销毁(线程退出阶段)时返回 nullptr,
+    // 调用方改用共享的后备环形队列
+    Ring* localRing()
+    {
+        if (LocalRings::destroyed())
+        {
+            return nullptr;
+        }
+
+        thread_local LocalRings local;
+        if (local.m_lastQueueId == m_id)
+        {
+            return local.m_lastRing;
+        }
+
+        for (auto& entry : local.m_entries)
+        {
+            if (entry.m_queueId == m_id)
+            {
+                local.m_lastQueueId = m_id;
+                local.m_lastRing = entry.m_ring.get();
+                return entry.m_ring.get();
+            }
+        }
+
+        // 回收已销毁队列留下的条目
+        auto& entries = local.m_entries;
+        for (size_t i = 0; i < entries.size();)
+        {
+            if (entries[i].m_ring->m_orphaned.load(std::memory_order_acquire))
+            {
+                entries[i] = std::move(entries.back());
+                entries.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        auto ring = std::make_shared<Ring>(m_ringCapacity);
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.push_back(ring);
+            m_ringsVersion.fetch_add(1, std::memory_order_release);
+        }
+        entries.push_back({m_id, ring});
+        local.m_lastQueueId = m_id;
+        local.m_lastRing = ring.get();
+        return ring.get();
+    }
+
+    // 消费者持有 m_consumerMutex 时调用
+    void refreshRings()
+    {
+        uint64_t version = m_ringsVersion.load(std::memory_order_acquire);
+        if (version == m_snapshotVersion)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_snapshot = m_rings;
+        m_snapshotVersion = m_ringsVersion.load(std::memory_order_relaxed);
+    }
+
+    // 消费者持有 m_consumerMutex 时调用:取出各队头中入队编号最小的一条
+    bool popEarliest(T& item)
+    {
+        Ring* earliest = nullptr;
+        Entry* earliestEntry = nullptr;
+        bool hasClosed = false;
+        while (true)
+        {
+            refreshRings();
+
+            earliest = nullptr;
+            earliestEntry = nullptr;
+            for (auto& ring : m_snapshot)
+            {
+                Entry* front = ring->m_queue.front();
+                if (front == nullptr)
+                {
+                    hasClosed |= ring->m_closed.load(std::memory_order_acquire);
+                    continue;
+                }
+                if (m_exitPolicy == ProducerExitPolicy::Discard && ring->m_closed.load(std::memory_order_acquire))
+                {
+                    hasClosed = true;
+                    continue;
+                }
+                if (earliestEntry == nullptr || front->m_ticket < earliestEntry->m_ticket)
+                {
+                    earliest = ring.get();
+                    earliestEntry = front;
+                }
+            }
+
+            // 看到队头之后再确认一次快照:编号更小的消息可能在快照之后新注册的环形队列里
+            if (m_ringsVersion.load(std::memory_order_acquire) == m_snapshotVersion)
+            {
+                break;
+            }
+        }
+
+        if (hasClosed)
+        {
+            reclaimClosedRings();
+        }
+
+        if (earliest == nullptr)
+        {
+            return false;
+        }
+
+        item = std::move(earliestEntry->m_item);
+        earliest->m_queue.popFront();
+        notifyProducer();
+        return true;
+    }
+
+    // 回收生产者已退出的环形队列(Discard 模式下丢弃剩余消息)
+    void reclaimClosedRings()
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (size_t i = 0; i < m_rings.size();)
+        {
+            Ring& ring = *m_rings[i];
+            if (!ring.m_closed.load(std::memory_order_acquire))
+            {
+                ++i;
+                continue;
+            }
+
+            if (m_exitPolicy == ProducerExitPolicy::Discard)
+            {
+                while (Entry* front = ring.m_queue.front())
+                {
+                    T discarded = std::move(front->m_item);
+                    ring.m_queue.popFront();
+                    m_overrunCount.fetch_add(1, std::memory_order_relaxed);
+                    this->evicted(discarded);
+                }
+            }
+
+            if (ring.m_queue.empty())
+            {
+                m_rings[i] = std::move(m_rings.back());
+                m_rings.pop_back();
+                m_ringsVersion.fetch_add(1, std::memory_order_release);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    bool hasData() const
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (auto& ring : m_rings)
+        {
+            if (!ring->m_queue.empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void notifyConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_consumerCond.notify_one();
+        }
+    }
+
+    void notifyProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producerWaiting.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_producerCond.notify_all();
+        }
+    }
+
+    const uint64_t m_id;
+    const size_t m_ringCapacity;
+    const ProducerExitPolicy m_exitPolicy;
+
+    // 已注册的环形队列(生产者注册/消费者回收)
+    mutable std::mutex m_ringsMutex;
+    std::vector<RingPtr> m_rings;
+    std::atomic<uint64_t> m_ringsVersion{0};
+
+    // 线程退出阶段的后备环形队列,多个生产者通过 m_fallbackMutex 串行写入
+    std::mutex m_fallbackMutex;
+    RingPtr m_fallbackRing;
+
+    // 消费者侧的快照,避免每次出队都加 m_ringsMutex
+    std::mutex m_consumerMutex;
+    std::vector<RingPtr> m_snapshot;
+    uint64_t m_snapshotVersion{0};
+
+    // 所有生产者共用的入队编号,单独占一个缓存行
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_nextTicket{0};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_overrunCount{0};
+    std::atomic<int> m_consumerWaiting{0};
+    std::atomic<int> m_producerWaiting{0};
+
+    std::mutex m_waitMutex;
+    std::condition_variable m_consumerCond;
+    std::condition_variable m_producerCond;
+};
+
+}
+}
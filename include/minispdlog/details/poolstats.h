@@ -0,0 +1,157 @@
+#pragma once
+
+#include "minispdlog/common.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace minispdlog {
+namespace details {
+
+// 延迟直方图(纳秒),HDR 风格的对数-线性分桶:
+//   - 小于 8ns 的值每个值一个桶
+//   - 之后每个 2 的幂区间等分为 8 个桶,相对误差不超过 12.5%
+//   - 超过 2^40ns(约 18 分钟)的值计入最后一个桶
+struct LatencyHistogram
+{
+    static constexpr size_t SUB_BITS = 3;
+    static constexpr size_t SUB_COUNT = size_t(1) << SUB_BITS;
+    static constexpr size_t MAX_BITS = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    std::array<uint64_t, BUCKET_COUNT> counts{};
+    uint64_t totalCount{0};
+    uint64_t sumNs{0};
+    uint64_t maxNs{0};
+
+    static size_t bucketIndex(uint64_t ns)
+    {
+        if (ns < SUB_COUNT)
+        {
+            return static_cast<size_t>(ns);
+        }
+        if (ns >= (uint64_t(1) << MAX_BITS))
+        {
+            return BUCKET_COUNT - 1;
+        }
+        size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+        size_t shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + static_cast<size_t>(ns >> shift) - SUB_COUNT;
+    }
+
+    // 桶的下界(含)
+    static uint64_t bucketLowerBound(size_t index)
+    {
+        if (index < SUB_COUNT)
+        {
+            return index;
+        }
+        size_t shift = index / SUB_COUNT - 1;
+        return (uint64_t(index % SUB_COUNT) + SUB_COUNT) << shift;
+    }
+
+    // 桶的上界(含)
+    static uint64_t bucketUpperBound(size_t index)
+    {
+        if (index + 1 >= BUCKET_COUNT)
+        {
+            return UINT64_MAX;
+        }
+        return bucketLowerBound(index + 1) - 1;
+    }
+
+    double meanNs() const
+    {
+        return totalCount == 0 ? 0.0 : static_cast<double>(sumNs) / static_cast<double>(totalCount);
+    }
+
+    // 分位数(0 ~ 1),返回所在桶的上界,不超过记录到的最大值
+    uint64_t percentile(double p) const
+    {
+        if (totalCount == 0)
+        {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(p * static_cast<double>(totalCount));
+        if (target == 0)
+        {
+            target = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        {
+            seen += counts[i];
+            if (seen >= target)
+            {
+                uint64_t upper = bucketUpperBound(i);
+                return upper < maxNs ? upper : maxNs;
+            }
+        }
+        return maxNs;
+    }
+};
+
+// LatencyHistogram 的并发记录版本:每个工作线程独占一个,只有它自己写,读取方随时取快照
+class AtomicLatencyHistogram
+{
+public:
+    void record(uint64_t ns)
+    {
+        m_counts[LatencyHistogram::bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > m_maxNs.load(std::memory_order_relaxed))
+        {
+            m_maxNs.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    // 累加到 out 中,多个线程的直方图可以合并到同一个快照
+    void addTo(LatencyHistogram& out) const
+    {
+        for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            uint64_t count = m_counts[i].load(std::memory_order_relaxed);
+            out.counts[i] += count;
+            out.totalCount += count;
+        }
+        out.sumNs += m_sumNs.load(std::memory_order_relaxed);
+        uint64_t maxNs = m_maxNs.load(std::memory_order_relaxed);
+        if (maxNs > out.maxNs)
+        {
+            out.maxNs = maxNs;
+        }
+    }
+
+    void reset()
+    {
+        for (auto& count : m_counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_sumNs.store(0, std::memory_order_relaxed);
+        m_maxNs.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT> m_counts{};
+    std::atomic<uint64_t> m_sumNs{0};
+    std::atomic<uint64_t> m_maxNs{0};
+};
+
+// ThreadPool::stats() 返回的快照,计数均为上次 resetStats 之后的值(depth 除外)
+struct ThreadPoolStats
+{
+    size_t depth{0};            // 当前已入队、尚未被工作线程取出的消息数(含控制消息)
+    size_t highWaterMark{0};    // depth 的最大值,由工作线程每次取出消息后采样
+    uint64_t enqueueCount{0};   // 成功入队的消息数(含优先通道)
+    uint64_t dequeueCount{0};   // 工作线程取出的消息数
+    uint64_t overrunCount{0};   // Overwrite 策略淘汰的消息数
+    uint64_t blockCount{0};     // 阻塞投递时队列已满、不得不等待的次数
+    uint64_t blockTimeNs{0};    // 上述等待的总时长
+    uint64_t maxBlockNs{0};     // 单次等待的最长时长
+    LatencyHistogram residency; // 消息驻留时间:从日志调用到 sink 写完
+};
+
+}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "minispdlog/common.h"
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace minispdlog {
+namespace details {
+
+// SPSCQueue: 单生产者单消费者无锁环形队列
+//   - 只允许一个线程 push,一个线程 pop
+//   - head/tail 分别位于独立缓存行,并各自缓存对端位置,减少跨核读取
+//   - 容量向上取整为 2 的幂
+template <typename T>
+class SPSCQueue
+{
+public:
+    explicit SPSCQueue(size_t capacity)
+        : m_capacity(roundUpPow2(capacity < 2 ? 2 : capacity)),
+          m_mask(m_capacity - 1),
+          m_data(new T[m_capacity])
+    {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // 生产者线程调用:队列满时返回 false
+    bool tryPush(T&& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_capacity)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_capacity)
+            {
+                return false; //队列已满
+            }
+        }
+        m_data[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 生产者线程调用:返回下一个可写的位置,队列满时返回 nullptr
+    // 原地写入之后调用 pushBack 发布,省去一次临时对象的移动
+    T* back()
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_capacity)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_capacity)
+            {
+                return nullptr; //队列已满
+            }
+        }
+        return &m_data[tail & m_mask];
+    }
+
+    // 生产者线程调用:必须在 back() 返回非空且元素已写入之后调用
+    void pushBack()
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+    // 消费者线程调用:队列为空时返回 nullptr
+    T* front()
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+            {
+                return nullptr; //队列为空
+            }
+        }
+        return &m_data[head & m_mask];
+    }
+
+    // 消费者线程调用:必须在 front() 返回非空且元素已被移走之后调用
+    void popFront()
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t head = m_head.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_data;
+
+    // 消费者侧
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail{0};
+
+    // 生产者侧
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead{0};
+};
+
+}
+}
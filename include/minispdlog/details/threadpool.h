@@ -2,10 +2,24 @@
 
 #include "minispdlog/common.h"
 #include "minispdlog/details/mpmcblockingqueue.h"
+#include "minispdlog/details/lockfreempmcqueue.h"
+#include "minispdlog/details/perthreadqueue.h"
+#include "minispdlog/details/byteringqueue.h"
+#include "minispdlog/details/elasticqueue.h"
 #include "minispdlog/details/asyncmsg.h"
+#include "minispdlog/details/poolstats.h"
+#include "minispdlog/sinks/basesink.h"
 #include <thread>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
 
 namespace minispdlog {
 
@@ -13,18 +27,167 @@ class AsyncLogger;
 
 namespace details {
 
+// 线程池使用的队列实现
+enum class QueueType
+{
+    Blocking,   // MPMCBlockingQueue: 互斥锁 + 条件变量
+    LockFree,   // LockFreeMPMCQueue: 无锁环形队列,适合大量生产者线程
+    PerThread,  // PerThreadQueue: 每个生产者线程独占 SPSC 环形队列,消费者按入队编号归并(先完成入队的消息先输出)
+    ByteRing,   // ByteRingQueue: 变长记录写入一块固定大小的连续内存,入队不分配内存
+    Elastic     // ElasticQueue: 按块增长,容量由内存预算(含 payload 字节)决定,空闲时释放多余的块
+};
+
+// 队列为空时工作线程的等待策略:先忙等(pause),再让出 CPU,最后挂起
+// 生产者只在工作线程挂起时才需要唤醒它,忙等/让出阶段的入队不产生系统调用
+struct WaitStrategy
+{
+    uint32_t spinCount{0};      // 忙等轮数,每轮一次 pause
+    uint32_t yieldCount{0};     // std::this_thread::yield 轮数
+    std::chrono::milliseconds parkTimeout{10};  // 挂起等待的超时;挂起的线程不持有消息,不会拖慢 flushAsync 与 logger 析构
+
+    // 低延迟:长时间忙等,空闲时占满一个核
+    static WaitStrategy lowLatency()
+    {
+        return WaitStrategy{200000, 20000, std::chrono::milliseconds(1)};
+    }
+
+    // 均衡:短暂忙等吸收突发流量,随后挂起
+    static WaitStrategy balanced()
+    {
+        return WaitStrategy{2000, 64, std::chrono::milliseconds(10)};
+    }
+
+    // 低 CPU:直接挂起,每条入队都可能需要唤醒
+    static WaitStrategy lowCpu()
+    {
+        return WaitStrategy{0, 0, std::chrono::milliseconds(100)};
+    }
+};
+
+// 分片模式下 logger 到分片的默认映射方式
+enum class ShardAffinity
+{
+    LoggerName, // 按 logger 名字哈希
+    SinkSet     // 按 sink 集合哈希:sink 集合完全相同的 logger 落在同一分片,sink 同一时刻只被一个线程按投递顺序写出
+                // (开启工作窃取时也是如此);sink 集合只是部分重叠的 logger 可能落在不同分片
+};
+
+// 工作线程的调度类
+enum class WorkerSchedPolicy
+{
+    Default,    // 不修改,继承创建线程池的线程
+    Batch       // SCHED_BATCH:按 CPU 密集型任务调度,不抢占交互/低延迟线程
+};
+
+// 线程池配置
+struct ThreadPoolOptions
+{
+    // 共享队列容量(Blocking/LockFree),两者满/覆盖的边界相同
+    // LockFree 的槽位数向上取整为 2 的幂,内存按取整后的槽位数分配(例如 10000 分配 16384 个槽位)
+    size_t queueSize{8192};
+    size_t threadSize{1};       // 工作线程数
+    QueueType queueType{QueueType::Blocking};
+
+    // PerThread 模式:每个生产者线程的环形队列容量,以及线程退出时的处理方式
+    size_t ringCapacity{1024};
+    ProducerExitPolicy producerExitPolicy{ProducerExitPolicy::Drain};
+
+    // ByteRing 模式:字节环的总大小,即队列的全部内存占用
+    size_t ringBytes{1024 * 1024};
+
+    // Elastic 模式:每块 elasticChunkSize 条消息,起始每个队列一个块,积压时逐块增长
+    // memoryBudget 为所有分片队列共用的字节预算(块的大小 + 溢出到堆上的 payload),用尽之后才按溢出策略处理
+    // 每个分片常驻一个块,预算至少要容纳 分片数 * elasticChunkSize * sizeof(AsyncMsg) 字节
+    size_t elasticChunkSize{256};
+    size_t memoryBudget{64 * 1024 * 1024};
+
+    // 批处理:工作线程一次最多取出 batchSize 条消息,同一 logger 的消息合并成组后整批交给 sink
+    // 分组不会改变任何一个 sink 上的写出顺序:logger 的消息只在与它共用 sink 的其他 logger 没有插入消息时才合并,
+    // 共用同一个文件的多个 logger 仍然按投递顺序交替写出(时间戳单调),只有 sink 互不相交的 logger 之间才会重排
+    // (这是单个工作线程内的保证;非分片模式下多个工作线程各自取批,不同批之间本来就没有先后顺序)
+    // batchMaxWait > 0 时,为凑满一批最多额外等待这么久(限制排队延迟的上限)
+    size_t batchSize{64};
+    std::chrono::milliseconds batchMaxWait{0};
+
+    // 队列为空时的等待策略
+    WaitStrategy waitStrategy{WaitStrategy::balanced()};
+
+    // 分片模式:每个工作线程独占一个队列(容量配置按分片计算),每个 logger 固定投递到一个分片
+    // 同一 logger 的消息总由同一线程按顺序写出;logger 也可以用 AsyncLogger::setShard 显式指定分片
+    bool sharded{false};
+    ShardAffinity shardAffinity{ShardAffinity::LoggerName};
+
+    // 工作窃取(仅分片模式有效):分片线程把一段消息按 sink 划分成互不相交的单元后公开
+    // (共用 sink 的 logger 在同一单元中),空闲的其他线程领走整个单元写出,分片线程等所有单元写完才处理下一段
+    // 同一分片内每个 sink 同一时刻只被一个线程按投递顺序写出,_st sink 也可以使用
+    // 只有一个 logger(或 logger 之间都通过 sink 相连)的分片只有一个单元,慢的 logger 得不到其他线程的帮助
+    // 不能与 fairQuantum 同时开启,否则构造函数抛出 std::invalid_argument
+    bool workStealing{false};
+
+    // 优先通道:每个分片额外一个容量为 priorityQueueSize 的小队列(0 表示不启用)
+    // 达到 AsyncLogger::setPriorityLevel 的消息投递到优先通道,工作线程每批都先处理它,不必排在普通消息之后
+    // 启用后每条消息都会分配全局递增的顺序号(LogMsg::m_sequence, %N)
+    size_t priorityQueueSize{0};
+
+    // 公平调度:> 0 时工作线程按差额轮询(DRR)在 logger 之间交替写出一批中的消息(不能与 workStealing 同时开启),
+    // 每轮给每个 logger fairQuantum 字节(按 payload 计)的额度,健谈的 logger 不会让同一批中其他 logger 的消息一直排在后面
+    // 交替只发生在工作线程取出的一批(最多 batchSize 条)之内,不改变批与批之间的先后:健谈的 logger 占满队列时,
+    // 其他 logger 的消息仍然要排到它们所在的那一批才会写出(限制队列占用请用 AsyncLogger::setQueueQuota)
+    // 同一 logger、同一 sink 上的消息仍然按投递顺序写出;0 表示按 logger 整组写出
+    size_t fairQuantum{0};
+
+    // 工作线程的运行环境(仅 Linux 生效,其他平台忽略),在工作线程开始处理消息之前设置
+    // 任何一项设置失败时构造函数抛出 std::runtime_error
+    // workerCpuSets[i] 为第 i 个工作线程允许运行的 CPU 编号,项数少于线程数时循环使用;为空表示不绑定
+    // 例:把日志 I/O 限制在 0、1 号管理核上,不干扰绑定在其他核上的低延迟线程
+    //   options.workerCpuSets = {{0}, {1}};
+    std::vector<std::vector<int>> workerCpuSets;
+    WorkerSchedPolicy workerSchedPolicy{WorkerSchedPolicy::Default};
+    // 工作线程的 nice 值(-20 ~ 19),0 表示不修改;负值需要 CAP_SYS_NICE 权限
+    int workerNice{0};
+    // 第 i 个工作线程命名为 threadNamePrefix + i(超过 15 字节截断),为空不命名
+    std::string threadNamePrefix{"minispdlog-"};
+    // 每个工作线程完成上述设置之后、处理消息之前调用一次,参数为线程序号
+    // 可以在这里做其他线程级初始化;抛出的异常会让构造函数失败
+    std::function<void(size_t)> onThreadStart;
+
+    // 统计(见 ThreadPool::stats):生产者每次入队只多一次无竞争的原子加法,
+    // 工作线程每批多一次深度采样和每条消息一次直方图记录
+    bool collectStats{true};
+};
+
+// 关闭线程池时如何处理队列中积压的消息
+enum class ShutdownMode
+{
+    DrainAll,   // 写出全部积压消息后退出
+    DrainUntil, // 在截止时间之前尽量写出,到期后丢弃剩余消息
+    Discard     // 丢弃全部积压消息,只等待正在写出的那一批
+};
+
+// ThreadPool::shutdown 的结果
+struct ShutdownResult
+{
+    size_t drained{0};      // 关闭开始之后写出的消息数
+    size_t discarded{0};    // 丢弃的消息数(含关闭之后才投递的消息)
+    bool completed{false};  // 工作线程是否都已退出;sink 卡住超过截止时间时为 false
+};
+
 // thread_pool: 异步日志的线程池
 // 参考 spdlog 设计:管理工作线程 + MPMC 队列
 //
 // 特性:
 //   - 创建指定数量的工作线程
-//   - 持有 MPMC 队列用于消息传递
+//   - 持有 MPMC 队列用于消息传递(阻塞队列或无锁队列,见 QueueType)
+//   - 默认所有线程共享一个队列;分片模式下每个线程独占一个队列
+//   - 分片模式可开启工作窃取,空闲线程帮繁忙分片写出其他 logger 的消息
 //   - 支持阻塞/非阻塞两种 post 模式
+//   - 工作线程可绑定 CPU、降低调度优先级并命名(Linux)
 //   - 支持优雅关闭
 class ThreadPool
 {
 public:
-    explicit ThreadPool(size_t queueSize, size_t threadSize);
+    explicit ThreadPool(const ThreadPoolOptions& options);
+    ThreadPool(size_t queueSize, size_t threadSize, QueueType queueType = QueueType::Blocking);
 
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
@@ -32,27 +195,274 @@ public:
     ~ThreadPool();
 
     // 向线程池中添加异步消息(阻塞)
-    void post(std::shared_ptr<AsyncLogger>&& logger, const LogMsg& msg);
+    // 消息只记录 logger 的裸指针,logger 必须在消息处理完之前保持存活(见 barrier)
+    void post(AsyncLogger* logger, const LogMsg& msg);
 
     // 向线程池中添加异步消息(非阻塞)
-    void postNoWait(std::shared_ptr<AsyncLogger>&& logger, const LogMsg& msg);
+    void postNoWait(AsyncLogger* logger, const LogMsg& msg);
+
+    // 向线程池中添加异步消息(丢弃模式):队列满时放弃本条消息并返回 false
+    bool tryPost(AsyncLogger* logger, const LogMsg& msg);
+
+    // 向线程池中添加异步消息(限时阻塞):队列满时最多等待 timeout,超时放弃本条消息并返回 false
+    bool postFor(AsyncLogger* logger, const LogMsg& msg, std::chrono::milliseconds timeout);
 
-    //投递刷新
-    void postFlush(std::shared_ptr<AsyncLogger>&& logger);
+    // 向优先通道投递消息(阻塞,不会丢弃);未启用优先通道时投递到普通队列
+    void postPriority(AsyncLogger* logger, const LogMsg& msg);
 
-    size_t overrunCount()
+    bool hasPriorityLane() const
     {
-        return m_queue.overrunCount();
+        return m_hasPriorityLane;
     }
 
+    // 下一个投递顺序号
+    uint64_t nextSequence()
+    {
+        return m_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    //投递刷新:completion 在刷新之前投递的消息全部写入、sink 刷新之后完成
+    void postFlush(AsyncLogger* logger, CompletionToken&& completion = CompletionToken());
+
+    // 屏障:阻塞到调用前投递到 logger 所在分片的消息都被工作线程处理完毕
+    // AsyncLogger 析构时调用,之后工作线程不会再访问该 logger
+    // 不能在工作线程中调用
+    void barrier(const AsyncLogger* logger);
+
+    size_t overrunCount();
+
+    // 关闭线程池:停止接收新消息,按 mode 处理积压,返回写出/丢弃的消息数
+    // 不会阻塞在已满的队列上;DrainUntil 最多写出 timeout 这么久,之后丢弃剩余消息,
+    // 到期后工作线程长时间没有进展(卡在 sink 中)时不再等待,返回 completed == false
+    // 可以重复调用收紧处理方式(例如 DrainAll 之后改为 Discard),不会放宽
+    // 开始关闭之后的投递直接丢弃;关闭完成之后的刷新在调用线程中同步执行;不能在工作线程中调用
+    // 析构时如果还没有关闭,按 DrainAll 关闭
+    ShutdownResult shutdown(ShutdownMode mode = ShutdownMode::DrainAll,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    // 队列统计快照,不加锁读取;未开启 collectStats 时只有 overrunCount 有效
+    // 各项计数分别读取,高并发下彼此之间不是严格一致的
+    ThreadPoolStats stats() const;
+
+    // 清零统计(depth 不受影响,highWaterMark 从当前深度重新开始)
+    // 与并发的记录之间没有同步,重置瞬间的少量记录可能丢失
+    void resetStats();
+
+    // 分片数:分片模式下等于线程数,否则为 1
+    size_t shardCount() const
+    {
+        return m_shards.size();
+    }
+
+    // Elastic 模式下所有队列当前占用的预算字节数,其他模式为 0
+    size_t memoryUsed() const
+    {
+        return m_memoryBudget ? m_memoryBudget->used() : 0;
+    }
+
+    // 按配置的 ShardAffinity 为 logger 选择默认分片
+    size_t defaultShard(const std::string& loggerName, const std::vector<sinks::SinkPtr>& sinks) const;
+
 private:
-    void loop();
-    // 处理下一条消息(返回 false 表示应该退出)
-    bool processNextMsg();
+    // 一段消息按 logger 分组的结果,依次写出各组即保持每个 sink 上的投递顺序
+    using LoggerGroups = std::vector<std::pair<AsyncLogger*, LogMsgBatch>>;
+
+    // 分组时一段消息中出现的 logger,m_openGroup 为它仍可追加消息的分组
+    struct LoggerSlot
+    {
+        AsyncLogger* m_logger;
+        size_t m_openGroup;
+    };
+    static constexpr size_t NO_GROUP = static_cast<size_t>(-1);
+
+    struct WorkerContext;
+
+    // 一个队列及消费它的工作线程
+    struct Shard
+    {
+        std::unique_ptr<AsyncQueue<AsyncMsg>> m_queue;
+        ByteRingQueue* m_byteRing{nullptr}; // ByteRing 模式下指向 m_queue,直接把 LogMsg 写入环中
+        std::unique_ptr<AsyncQueue<AsyncMsg>> m_priorityQueue;  // 优先通道,未启用时为空
+        std::vector<size_t> m_workerIndices;
+
+        // 工作窃取:分片线程公开的单元(分组及划分结果在 m_stealCtx 中),[m_stealNext, m_stealCount) 尚未被领走
+        std::mutex m_stealMutex;
+        WorkerContext* m_stealCtx{nullptr};
+        size_t m_stealNext{0};
+        size_t m_stealCount{0};
+        std::atomic<bool> m_stealable{false};   // 是否还有未领走的单元,空闲线程无锁预检
+        std::atomic<size_t> m_stealDone{0};     // 已写完的公开单元数
+    };
+
+    // 每个工作线程私有的批处理缓冲区,循环复用避免重复分配
+    struct WorkerContext
+    {
+        size_t m_index{0};
+        Shard* m_shard{nullptr};
+        std::vector<AsyncMsg> m_batch;
+        std::vector<AsyncMsg> m_priorityBatch;
+        LogMsgBatch m_logMsgs;
+        std::vector<LoggerSlot> m_slots;
+        LoggerGroups m_groups;  // 分组结果,只增不减,容量循环复用
+        std::vector<size_t> m_groupPos;     // 公平调度:各分组下一条待写出消息的下标
+        std::vector<size_t> m_deficits;     // 公平调度:各分组剩余的字节额度
+        std::vector<size_t> m_blockers;     // 公平调度:各分组之前尚未写完的、与它共用 sink 的分组数
+
+        // 工作窃取:按 sink 把分组划分成单元,第 u 个单元为 m_unitGroups[m_unitBegin[u], m_unitBegin[u + 1])
+        std::vector<size_t> m_unitParent;   // 并查集,按 m_slots 下标
+        std::vector<size_t> m_unitOf;       // 并查集的根对应的单元编号
+        std::vector<size_t> m_groupUnits;   // 各分组所在的单元
+        std::vector<size_t> m_unitBegin;
+        std::vector<size_t> m_unitFill;
+        std::vector<size_t> m_unitGroups;
+
+        // 延迟格式化的结果:整批消息共用一块文本缓冲区
+        fmt::memory_buffer m_deferredText;
+        std::vector<std::pair<size_t, size_t>> m_deferredRanges;  // (消息下标, 文本起始偏移)
+    };
+
+    Shard& shardOf(const AsyncLogger* logger);
+    // 关闭:等待所有工作线程退出(join),完成剩余的刷新并丢弃队列中剩下的消息
+    void finishStop();
+    // 工作线程退出前调用
+    void workerExited();
+    bool stopRequested() const
+    {
+        return m_stopRequest.load(std::memory_order_acquire) != 0;
+    }
+    // 关闭过程中是否应该丢弃而不是写出
+    bool shouldDiscard() const;
+    // 丢弃一组消息:归还配额、完成屏障,刷新请求随消息析构收到异常
+    void discardMsgs(std::vector<AsyncMsg>& msgs);
+    // 不会被写出的单条消息(丢弃或被覆盖淘汰):归还配额、完成屏障,不计入丢弃数
+    static void releaseMsg(AsyncMsg& msg);
+    // 工作线程全部退出之后,丢弃仍留在队列中的消息
+    void drainDiscard();
+    // 开始关闭之后投递的普通消息
+    void discardPost(AsyncLogger* logger);
+    // 阻塞入队:先尝试不等待地入队,队列满时才计时并阻塞,统计阻塞次数与时长
+    void enqueueBlocking(AsyncQueue<AsyncMsg>& queue, AsyncMsg&& msg);
+    void recordBlocked(std::chrono::steady_clock::time_point start);
+    // 生产者入队成功后计数,按线程分散到不同的缓存行
+    void countEnqueued(size_t count = 1);
+    uint64_t totalEnqueued() const;
+    uint64_t totalDequeued() const;
+    uint64_t totalOverrun() const;
+    // 工作线程取出一批消息后调用:采样深度、更新高水位并计数
+    void countDequeued(size_t workerIndex, size_t count);
+    // 本批消息写完之后调用:记录驻留时间
+    void recordResidency(WorkerContext& ctx);
+    void loop(size_t index);
+    // 取出并处理下一批消息(返回 false 表示应该退出)
+    bool processNextBatch(WorkerContext& ctx);
+    // 进入奇数纪元,不等待地取出一批消息(普通队列 + 优先通道),fill 为 true 时按 batchMaxWait 凑批
+    // 什么也没取到时回到偶数纪元并返回 0
+    size_t takeBatch(WorkerContext& ctx, bool fill);
+    // 本批处理完(或没取到消息)时回到偶数纪元,唤醒等待纪元变化的 barrier 并检查待完成的刷新
+    void leaveEpoch(size_t workerIndex);
+    // 按等待策略取出下一批消息,超时返回 0
+    size_t waitForBatch(WorkerContext& ctx);
+    // 格式化本批中延迟格式化的消息,并把它们的 m_payload 指向格式化结果
+    void formatDeferred(WorkerContext& ctx);
+    // 处理 Flush 消息:多个工作线程时,要等其他线程写完更早取出的消息才能刷新
+    void handleFlush(WorkerContext& ctx, AsyncMsg& msg);
+    // 工作线程回到偶数纪元之后调用:完成所有已满足条件的刷新
+    void completePendingFlushes();
+    // 处理 m_batch[first, last) 这段连续的 Log 消息:按 logger 分组,组内保持原有顺序
+    void dispatchLogMsgs(WorkerContext& ctx, size_t first, size_t last);
+    // 把 m_batch[first, last) 分组到 ctx.m_groups,返回组数
+    // 共用 sink 的另一个 logger 插入消息之后,logger 原来的分组封闭,之后的消息另起一组
+    size_t buildGroups(WorkerContext& ctx, size_t first, size_t last);
+    static bool sharesSink(const AsyncLogger& a, const AsyncLogger& b);
+    // 公平调度模式:按差额轮询交替写出前 groupCount 个分组,共用 sink 的分组仍按先后顺序写出
+    void dispatchGroupsFair(WorkerContext& ctx, size_t groupCount);
+    // 工作窃取模式:把前 groupCount 个分组按 sink 划分成单元并公开,与空闲线程一起写出,返回时所有分组都已写完
+    void dispatchGroupsShared(WorkerContext& ctx, size_t groupCount);
+    // 把前 groupCount 个分组划分成 sink 互不相交的单元,返回单元数;只有一个单元时不填写单元内的分组列表
+    size_t buildUnits(WorkerContext& ctx, size_t groupCount);
+    // 按先后顺序写出一个单元中的分组
+    static void writeUnit(WorkerContext& ctx, size_t unit);
+    // 空闲时从其他分片领走一个公开的单元并写出,没有可领的单元返回 false
+    bool stealWork(WorkerContext& ctx);
+
+    // 每个工作线程的处理纪元:奇数表示可能持有已取出但未处理完的消息
+    // 只在取出消息到处理完这段时间处于奇数纪元,自旋、挂起等待和窃取期间都是偶数
+    struct alignas(CACHE_LINE_SIZE) WorkerEpoch
+    {
+        std::atomic<uint64_t> m_value{0};
+    };
+
+    // DrainUntil 到期之后,工作线程超过这么久没有任何进展就不再等待它们
+    static constexpr std::chrono::milliseconds SHUTDOWN_STALL_TIMEOUT{100};
+
+    // 入队计数的分散槽
+    static constexpr size_t STAT_STRIPES = 16;
+    struct alignas(CACHE_LINE_SIZE) StatCounter
+    {
+        std::atomic<uint64_t> m_value{0};
+    };
+
+    // 每个工作线程私有的统计,只有它自己写
+    struct alignas(CACHE_LINE_SIZE) WorkerStats
+    {
+        std::atomic<uint64_t> m_dequeued{0};
+        AtomicLatencyHistogram m_residency;
+    };
+
+    // 等待其他工作线程结束当前批次的刷新请求
+    // 拷贝 logger 的 sink 列表,完成时不再访问 logger 本身(logger 可能已经析构)
+    struct PendingFlush
+    {
+        std::vector<sinks::SinkPtr> m_sinks;
+        CompletionToken m_completion;
+        std::vector<uint64_t> m_epochs; // 创建时各工作线程的奇数纪元,0 表示无需等待
+    };
 
 private:
     std::vector<std::thread> m_workers; // 工作线程
-    MPMCBlockingQueue<details::AsyncMsg> m_queue; // MPMC 队列
+    std::unique_ptr<WorkerEpoch[]> m_workerEpochs;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::shared_ptr<MemoryBudget> m_memoryBudget;  // Elastic 模式下各分片共用,其他模式为空
+    size_t m_batchSize;
+    std::chrono::milliseconds m_batchMaxWait;
+    WaitStrategy m_waitStrategy;
+    ShardAffinity m_shardAffinity;
+    bool m_workStealing;
+    bool m_hasPriorityLane;
+    size_t m_fairQuantum;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_sequence{0};
+
+    bool m_collectStats;
+    StatCounter m_enqueueCounts[STAT_STRIPES];
+    std::unique_ptr<WorkerStats[]> m_workerStats;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_highWaterMark{0};
+    std::atomic<uint64_t> m_blockCount{0};
+    std::atomic<uint64_t> m_blockTimeNs{0};
+    std::atomic<uint64_t> m_maxBlockNs{0};
+    // resetStats 时的累计值,快照中的计数为累计值减去它们
+    std::atomic<uint64_t> m_enqueueBase{0};
+    std::atomic<uint64_t> m_dequeueBase{0};
+    std::atomic<uint64_t> m_overrunBase{0};
+
+    // 关闭状态:m_stopRequest 为 0 表示运行中,否则为 ShutdownMode + 1
+    std::atomic<int> m_stopRequest{0};
+    std::atomic<int64_t> m_stopDeadline{0};     // DrainUntil 的截止时间(steady_clock 纳秒)
+    std::atomic<bool> m_stopped{false};         // 工作线程都已退出
+    std::atomic<size_t> m_drainedCount{0};
+    std::atomic<size_t> m_discardedCount{0};
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCond;
+    size_t m_exitedWorkers{0};
+    std::mutex m_drainMutex;
+
+    std::mutex m_pendingMutex;
+    std::vector<PendingFlush> m_pendingFlushes;
+    std::atomic<size_t> m_pendingFlushCount{0};
+
+    // barrier 等待工作线程的纪元变化;只有存在等待者时工作线程才加锁唤醒
+    std::mutex m_epochMutex;
+    std::condition_variable m_epochCond;
+    std::atomic<size_t> m_epochWaiters{0};
 };
 
 }
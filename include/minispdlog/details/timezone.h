@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../common.h"
+#include <cstdint>
+#include <ctime>
+
+namespace minispdlog {
+namespace details {
+
+// 把 Unix 秒数换算为日历字段(不考虑时区),纯整数运算,不调用 libc
+// 年月日按 proleptic 公历换算(days_from_civil 的逆运算),tm_isdst 置 0
+inline void civilTime(int64_t secs, std::tm& out)
+{
+    int64_t days = secs / 86400;
+    int64_t rem = secs % 86400;
+    if (rem < 0)
+    {
+        rem += 86400;
+        --days;
+    }
+    out.tm_hour = static_cast<int>(rem / 3600);
+    out.tm_min = static_cast<int>(rem % 3600 / 60);
+    out.tm_sec = static_cast<int>(rem % 60);
+    out.tm_wday = static_cast<int>((days % 7 + 11) % 7); // 1970-01-01 是星期四
+
+    // 以 3 月 1 日为一年的开始,闰日落在年末
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t mon = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + (mon <= 2 ? 1 : 0);
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+    out.tm_year = static_cast<int>(year - 1900);
+    out.tm_mon = static_cast<int>(mon - 1);
+    out.tm_mday = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    out.tm_yday = static_cast<int>(mon <= 2 ? doy - 306 : doy + 59 + (leap ? 1 : 0));
+    out.tm_isdst = 0;
+}
+
+// 本地时间相对 UTC 的偏移缓存
+// 刷新时调用 localtime_r 取得偏移,并探测前后各一天内的夏令时切换点,得到偏移不变的区间 [m_validFrom, m_validUntil)
+// 区间内的换算只是 civilTime(secs + offset),只有越过切换点(或离开探测范围)时才再次调用 localtime_r
+// 假设一天之内至多切换一次;进程运行期间修改 TZ 不会被察觉,直到离开当前区间
+class UtcOffsetCache
+{
+public:
+    // secs 时刻本地时间相对 UTC 的偏移(秒,东区为正)
+    int32_t offsetAt(int64_t secs)
+    {
+        if (secs < m_validFrom || secs >= m_validUntil)
+        {
+            refresh(secs);
+        }
+        return m_offset;
+    }
+
+private:
+    void refresh(int64_t secs);
+
+    int32_t m_offset{0};
+    int64_t m_validFrom{1};     // 初始为空区间,第一次调用时刷新
+    int64_t m_validUntil{0};
+};
+
+// 按 timeType 把 secs 换算为日历字段,offset 返回相对 UTC 的偏移(%z 使用)
+inline void toCalendar(int64_t secs, PatternTimeType timeType, UtcOffsetCache& cache, std::tm& out, int32_t& offset)
+{
+    offset = timeType == PatternTimeType::Utc ? 0 : cache.offsetAt(secs);
+    civilTime(secs + offset, out);
+}
+
+}
+}
@@ -5,6 +5,7 @@
 #include "sinks/basesink.h"
 #include "details/logmsg.h"
 #include "details/threadpool.h"
+#include "details/deferredformat.h"
 #include <fmt/format.h>
 #include <vector>
 #include <memory>
@@ -65,6 +66,16 @@ public:
             return;
         }
 
+        // 延迟格式化:参数全部可以按值捕获时,只序列化参数,由后台线程格式化
+        if constexpr (details::DeferredArgs<std::decay_t<Args>...>::capturable)
+        {
+            if(m_deferredFormat)
+            {
+                logDeferred<std::decay_t<Args>...>(lvl, StringView(fmt.get().data(), fmt.get().size()), args...);
+                return;
+            }
+        }
+
         fmt::memory_buffer buf;
         fmt::format_to(std::back_inserter(buf), fmt, std::forward<Args>(args)...);
         details::LogMsg msg(m_name, lvl, StringView(buf.data(), buf.size()));
@@ -90,6 +101,18 @@ public:
     const std::string& name() const;
 
 protected:
+    template<typename... Args>
+    void logDeferred(level lvl, StringView formatStr, const Args&... args)
+    {
+        using Codec = details::DeferredArgs<Args...>;
+        fmt::memory_buffer buf;
+        buf.resize(Codec::encodedSize(formatStr, args...));
+        Codec::encode(buf.data(), formatStr, args...);
+        details::LogMsg msg(m_name, lvl, StringView(buf.data(), buf.size()));
+        msg.m_formatArgs = &Codec::format;
+        sinkLog(msg);
+    }
+
     virtual void sinkLog(const details::LogMsg& msg);
     virtual void sinkFlush();
 
@@ -99,6 +122,7 @@ protected:
     std::vector<sinks::SinkPtr> m_sinks;
     level m_level{level::trace};
     level m_flushLevel{level::off};
+    bool m_deferredFormat{false};   // 只有 AsyncLogger 可以开启,见 AsyncLogger::setDeferredFormat
 
 };
 
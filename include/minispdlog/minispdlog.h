@@ -55,6 +55,18 @@ inline void flushAll()
     Registry::instance().flushAll();
 }
 
+// 刷新所有 logger,并等待异步 logger 的数据真正写入(最多 timeout)
+inline bool flushAllFor(std::chrono::milliseconds timeout) 
+{
+    return Registry::instance().flushAllFor(timeout);
+}
+
+// 后台周期刷新所有 logger(跳过含 _st sink 的同步 logger),interval 为 0 时停止
+inline void flushEvery(std::chrono::milliseconds interval) 
+{
+    Registry::instance().flushEvery(interval);
+}
+
 //工厂函数，快速创建logger
 inline std::shared_ptr<Logger> colorStdoutMTLogger(const std::string& name) 
 {
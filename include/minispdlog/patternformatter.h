@@ -2,6 +2,8 @@
 
 #include "formatter.h"
 #include "level.h"
+#include "details/patternflags.h"
+#include "details/timezone.h"
 #include <vector>
 #include <string>
 #include <memory>
@@ -11,14 +13,29 @@
 namespace minispdlog
 {
 
+// PatternFormatter: 运行期 pattern 的格式化器
+// pattern 编译为一段紧凑的指令数组(占位符 + 宽度说明 + 文本池中的偏移),format 用一个 switch 循环解释执行
+// 指令与文本池都是连续内存,clone 只是拷贝这两块内存,不重新解析
+// 相邻的时间占位符与普通文本(如 "[%Y-%m-%d %H:%M:%S.%e] ")合并为一段,每秒只渲染一次,之后每条消息只复制缓存,
+// 段内的毫秒/微秒/纳秒在复制之后按位置直接写入定宽数字
+// 日历字段由纯整数运算得到:Utc 模式偏移为 0,Local 模式使用缓存的 UTC 偏移,只在夏令时切换时调用 localtime_r
 class PatternFormatter : public Formatter
 {
 public:
-    // pattern 示例: "[%Y-%m-%d %H:%M:%S] [%t] [%l] [%n] [%F:%f:%P] %v"
-    //年 月 日 时 分 秒 线程ID 级别简称 级别全称 Logger名称 消息 源文件 源文件名 源代码行号
-    explicit PatternFormatter(std::string pattern = "[%Y-%m-%d %H:%M:%S] [%t] [%l] [%n] %v");
+    // pattern 示例: "[%Y-%m-%d %H:%M:%S] [%t] [%l] [%n] %v"
+    //年 月 日 时 分 秒 线程ID 级别简称 级别全称 Logger名称 消息
+    //%N: 异步投递顺序号(线程池启用优先通道时分配,否则为 0)
+    //%e %f %F: 毫秒(3 位) 微秒(6 位) 纳秒(9 位)
+    //%o %i %u %O: 距本格式化器上一条消息的毫秒/微秒/纳秒/秒数(第一条为 0)
+    //%z: 相对 UTC 的偏移(+08:00),Utc 模式下为 +00:00
+    //占位符可以指定宽度:%8l 右对齐,%-8l 左对齐,%=8l 居中,%8!l 超出宽度时截断(宽度最大 64)
+    explicit PatternFormatter(std::string pattern = "[%Y-%m-%d %H:%M:%S] [%t] [%l] [%n] %v",
+                              PatternTimeType timeType = PatternTimeType::Local);
     ~PatternFormatter() override = default;
 
+    PatternFormatter(const PatternFormatter&) = default;
+    PatternFormatter& operator=(const PatternFormatter&) = default;
+
     //实现format接口
     void format(const details::LogMsg& msg, fmt::memory_buffer& dest) override;
     std::unique_ptr<Formatter> clone() const override;
@@ -26,27 +43,70 @@ public:
     //设置新的格式
     void setPattern(const std::string& pattern);
 
-public:
-    //抽象基类:处理单个占位符
-    class FlagFormatter
+private:
+    // 一条指令:m_op 为占位符字符或下面的特殊操作码
+    struct Instruction
     {
-    public:
-        virtual ~FlagFormatter() = default;
-        virtual void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) = 0;
-        virtual std::unique_ptr<FlagFormatter> clone() const = 0;
+        char m_op{0};
+        details::flags::PadSpec m_pad;
+        uint32_t m_offset{0};
+        uint32_t m_size{0};
     };
+    static constexpr char OP_TEXT = 0;      // 输出文本池中的 [m_offset, m_offset + m_size)
+    static constexpr char OP_TIME_RUN = 1;  // 输出 m_timeRuns[m_offset] 的缓存
 
-private:
-    //将pattern编译为FlagFormatter
+    // 一段相邻的时间占位符与普通文本,秒数变化时按 m_timeCode 中的指令重新渲染到 m_timeCache
+    // 段内不带宽度说明的 %e/%f/%F 渲染为占位的 0,m_timePatches[m_patchBegin, m_patchEnd) 记录它们的位置
+    struct TimeRun
+    {
+        uint32_t m_codeBegin{0};
+        uint32_t m_codeEnd{0};
+        uint32_t m_cacheOffset{0};
+        uint32_t m_cacheSize{0};
+        uint32_t m_patchBegin{0};
+        uint32_t m_patchEnd{0};
+    };
+
+    // 需要逐条消息写入的秒以下字段,m_offset 为相对段首的位置
+    struct TimePatch
+    {
+        uint32_t m_offset{0};
+        char m_flag{0};
+    };
+
+    // parsePattern 的回调,把解析结果追加为指令
+    struct Compiler;
+
+    //将pattern编译为指令数组
     void compilePattern();
+    // 把相邻的时间占位符与普通文本替换为 OP_TIME_RUN
+    void groupTimeRuns();
+    static bool inTimeRun(const Instruction& ins);
+    // 秒数变化时调用:重新渲染所有时间段
+    void renderTimeRuns(const details::LogMsg& msg);
+    void execute(const Instruction& ins, const details::LogMsg& msg, fmt::memory_buffer& dest) const;
 
-    std::tm getTime(const details::LogMsg& msg);
     std::string m_pattern;
-    std::vector<std::unique_ptr<FlagFormatter>> m_formatters;
+    PatternTimeType m_timeType;
+    std::vector<Instruction> m_code;
+    std::string m_text;         // 文本池:所有普通文本首尾相连
+    bool m_needsTime{false};    // 含有时间占位符时才换算本地时间
+    std::vector<Instruction> m_timeCode;
+    std::vector<TimeRun> m_timeRuns;
+    std::vector<TimePatch> m_timePatches;
+
+    // 含有 %o/%i/%u/%O 时记录上一条消息的时间
+    bool m_needsElapsed{false};
+    bool m_hasLastMsg{false};
+    LogClock::time_point m_lastMsgTime;
+    int64_t m_elapsedNs{0};
 
-    //时间缓存
-    std::chrono::seconds m_lastTimeSec{0};
+    //时间缓存,m_utcOffset 为当前这一秒相对 UTC 的偏移
+    std::chrono::seconds m_lastTimeSec{std::chrono::seconds::min()};
     std::tm m_cachedTm{};
+    int32_t m_utcOffset{0};
+    details::UtcOffsetCache m_offsetCache;
+    std::string m_timeCache;    // 当前这一秒所有时间段的渲染结果
 };
 
 }
\ No newline at end of file
@@ -3,10 +3,13 @@
 #include "common.h"
 #include "logger.h"
 #include "details/threadpool.h"
+#include "details/periodicworker.h"
 #include <string>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <chrono>
+#include <vector>
 
 namespace minispdlog
 {
@@ -34,25 +37,61 @@ public:
     //设置所有logger级别，刷新所有logger
     void setLevel(level lvl);
     void flushAll();
+    // 刷新所有 logger 并等待完成:先给所有异步 logger 投递刷新请求,再统一等待
+    // 全部在 timeout 内完成返回 true
+    bool flushAllFor(std::chrono::milliseconds timeout);
+
+    // 后台线程每隔 interval 刷新所有已注册的 logger 和默认 logger,写日志的线程不承担刷新开销
+    // 异步 logger 只投递刷新请求(由线程池的工作线程执行),同步 logger 在后台线程中直接刷新
+    // 同步 logger 只要有一个 _st sink 就跳过:后台线程与写日志的线程同时操作它会产生数据竞争,
+    // 这类 logger 需要自己 flush 或使用 flushOn
+    // 数据最多丢失约 interval 时长的日志;再次调用会替换原来的间隔,interval 为 0 时停止
+    void flushEvery(std::chrono::milliseconds interval);
 
     //初始化全局线程池
     // 注意:必须在创建异步 logger 之前调用
-    void initThreadPool(size_t queueSize = 8192, size_t threadSize = 1);
+    void initThreadPool(
+        size_t queueSize = 8192,
+        size_t threadSize = 1,
+        details::QueueType queueType = details::QueueType::Blocking
+    );
+    void initThreadPool(const details::ThreadPoolOptions& options);
 
     std::shared_ptr<details::ThreadPool> getThreadPool();
 
     void setThreadPool(std::shared_ptr<details::ThreadPool> threadPool);
 
+    // 命名线程池:不同用途的 logger 使用各自的队列和工作线程,互不影响
+    // 例:"audit" 单线程大队列保证不丢,"debug" 配合 Overwrite 策略只求不阻塞
+    // 重复初始化同名线程池会替换它;已创建的 logger 持有旧线程池,直到它们被销毁
+    void initThreadPool(const std::string& poolName, const details::ThreadPoolOptions& options);
+    void setThreadPool(const std::string& poolName, std::shared_ptr<details::ThreadPool> threadPool);
+
+    // poolName 为空时返回默认线程池;命名线程池不存在时抛出 std::runtime_error
+    std::shared_ptr<details::ThreadPool> getThreadPool(const std::string& poolName);
+
+    // 只从注册表移除,使用它的 logger 仍然可以继续记录
+    void dropThreadPool(const std::string& poolName);
+
 private:
     Registry();
     ~Registry() = default;
 
     void ifExistsThrow(const std::string& loggerName);
+    // 在锁内拷贝所有 logger(含默认 logger),之后在锁外逐个处理
+    std::vector<std::shared_ptr<Logger>> snapshotLoggers();
+    // flushEvery 后台线程的回调:跳过含 _st sink 的同步 logger
+    void flushPeriodic();
 
     std::mutex m_mutex;
     std::unordered_map<std::string, std::shared_ptr<Logger>> m_loggers;
     std::shared_ptr<Logger> m_defaultLogger;
     std::shared_ptr<details::ThreadPool> m_threadPool;
+    std::unordered_map<std::string, std::shared_ptr<details::ThreadPool>> m_threadPools;
+
+    // 周期刷新线程的回调要获取 m_mutex,启停它使用单独的锁;最后声明,最先析构
+    std::mutex m_flusherMutex;
+    std::unique_ptr<details::PeriodicWorker> m_periodicFlusher;
 };
 
 }//minispdlog
\ No newline at end of file
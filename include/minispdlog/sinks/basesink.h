@@ -6,6 +6,7 @@
 #include "../patternformatter.h"
 #include <mutex>
 #include <memory>
+#include <type_traits>
 
 namespace minispdlog {
 namespace sinks {
@@ -16,6 +17,18 @@ public:
     virtual ~Sink() = default;
     //输出日志
     virtual void log(const details::LogMsg& msg) = 0;
+
+    //批量输出日志:默认逐条调用 log,子类可以覆盖以减少加锁与写入次数
+    virtual void logBatch(const details::LogMsgBatch& msgs)
+    {
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (shouldLog(msg->m_level))
+            {
+                log(*msg);
+            }
+        }
+    }
     //刷新缓冲区
     virtual void flush() = 0;
 
@@ -26,6 +39,15 @@ public:
     virtual bool shouldLog(level msgLevel) const = 0;
 
     virtual void setFormatter(std::unique_ptr<Formatter> formatter) = 0;
+
+    // 能否被多个线程同时调用;_st sink 返回 false,只能由写日志的线程自己使用
+    virtual bool threadSafe() const { return true; }
+};
+
+struct NullMutex
+{
+    void lock() {}
+    void unlock() {}
 };
 
 template<typename Mutex>
@@ -45,6 +67,13 @@ public:
         sinkLog(msg);
     }
 
+    // 整批只加一次锁
+    void logBatch(const details::LogMsgBatch& msgs) override
+    {
+        std::lock_guard<Mutex> lock(m_mutex);
+        sinkLogBatch(msgs);
+    }
+
     void flush() override
     {
         std::lock_guard<Mutex> lock(m_mutex);
@@ -75,10 +104,27 @@ public:
         m_formatter = std::move(formatter);
     }
 
+    bool threadSafe() const override
+    {
+        return !std::is_same<Mutex, NullMutex>::value;
+    }
+
 protected:
     virtual void sinkLog(const details::LogMsg& msg) = 0;
     virtual void sinkFlush() = 0;
 
+    // 持有 m_mutex 时调用:过滤级别后逐条输出
+    virtual void sinkLogBatch(const details::LogMsgBatch& msgs)
+    {
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (logLevelEnabled(m_level, msg->m_level))
+            {
+                sinkLog(*msg);
+            }
+        }
+    }
+
     void formatMessage(const details::LogMsg& msg, fmt::memory_buffer& dest)
     {
         m_formatter->format(msg, dest);
@@ -89,12 +135,6 @@ protected:
     std::unique_ptr<Formatter> m_formatter;
 };
 
-struct NullMutex
-{
-    void lock() {}
-    void unlock() {}
-};
-
 using SinkPtr = std::shared_ptr<Sink>;
 
 }//sink
@@ -21,6 +21,19 @@ protected:
         this->formatMessage(msg, formattedMsg);
         std::cout.write(formattedMsg.data(), formattedMsg.size());
     }
+
+    void sinkLogBatch(const details::LogMsgBatch& msgs) override
+    {
+        fmt::memory_buffer formattedMsgs;
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (logLevelEnabled(this->m_level, msg->m_level))
+            {
+                this->formatMessage(*msg, formattedMsgs);
+            }
+        }
+        std::cout.write(formattedMsgs.data(), formattedMsgs.size());
+    }
     
     void sinkFlush() override
     {
@@ -47,6 +60,19 @@ protected:
         std::cerr.write(formattedMsg.data(), formattedMsg.size());
     }
 
+    void sinkLogBatch(const details::LogMsgBatch& msgs) override
+    {
+        fmt::memory_buffer formattedMsgs;
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (logLevelEnabled(this->m_level, msg->m_level))
+            {
+                this->formatMessage(*msg, formattedMsgs);
+            }
+        }
+        std::cerr.write(formattedMsgs.data(), formattedMsgs.size());
+    }
+
     void sinkFlush() override
     {
         std::cerr << std::flush;
@@ -38,6 +38,20 @@ protected:
         m_fileStream.write(formattedMsg.data(), formattedMsg.size());
     }
 
+    // 整批格式化到同一块缓冲区,只写一次文件流
+    void sinkLogBatch(const details::LogMsgBatch& msgs) override
+    {
+        fmt::memory_buffer formattedMsgs;
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (logLevelEnabled(this->m_level, msg->m_level))
+            {
+                this->formatMessage(*msg, formattedMsgs);
+            }
+        }
+        m_fileStream.write(formattedMsgs.data(), formattedMsgs.size());
+    }
+
     void sinkFlush() override
     {
         m_fileStream.flush();
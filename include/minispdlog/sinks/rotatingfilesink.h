@@ -90,12 +90,56 @@ protected:
         }
     }
 
+    // 整批格式化后合并写入,只有需要轮转时才提前落盘
+    void sinkLogBatch(const details::LogMsgBatch& msgs) override
+    {
+        fmt::memory_buffer pending;
+        fmt::memory_buffer formattedMsg;
+        for (const details::LogMsg* msg : msgs)
+        {
+            if (!logLevelEnabled(this->m_level, msg->m_level))
+            {
+                continue;
+            }
+
+            formattedMsg.clear();
+            this->formatMessage(*msg, formattedMsg);
+            if (m_currentSize + pending.size() + formattedMsg.size() > m_maxSize)
+            {
+                writeBuffer(pending);
+                pending.clear();
+                rotateFiles();
+                m_currentSize = 0; // 重置当前大小
+            }
+            pending.append(formattedMsg.data(), formattedMsg.data() + formattedMsg.size());
+        }
+        writeBuffer(pending);
+    }
+
     void sinkFlush() override
     {
         m_fileStream.flush();
     }
 
 private:
+    void writeBuffer(const fmt::memory_buffer& buffer)
+    {
+        if (buffer.size() == 0)
+        {
+            return;
+        }
+
+        if(m_fileStream.is_open())
+        {
+            m_fileStream.write(buffer.data(), buffer.size());
+            m_currentSize += buffer.size();
+        }
+        else
+        {
+            throw std::runtime_error("Log file stream is not open");
+        }
+    }
+
     void rotateFiles()
     {
         if(m_fileStream.is_open())
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "formatter.h"
+#include "details/patternflags.h"
+#include "details/timezone.h"
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <utility>
+
+namespace minispdlog
+{
+
+namespace details {
+namespace static_pattern {
+
+// 编译后的一段:m_flag 为 0 表示普通文本 m_text[m_offset, m_offset + m_size),否则为占位符
+struct Segment
+{
+    char m_flag{0};
+    flags::PadSpec m_pad{};
+    size_t m_offset{0};
+    size_t m_size{0};
+};
+
+// N 为 pattern 长度 + 1,段数与文本长度都不会超过它
+template <size_t N>
+struct CompiledPattern
+{
+    Segment m_segments[N]{};
+    size_t m_count{0};
+    char m_text[N]{};
+    size_t m_textSize{0};
+    bool m_needsTime{false};
+    bool m_needsElapsed{false};
+};
+
+constexpr size_t length(const char* str)
+{
+    size_t n = 0;
+    while (str[n] != '\0')
+    {
+        ++n;
+    }
+    return n;
+}
+
+// flags::parsePattern 的编译期回调,相邻的普通文本合并为一段
+template <size_t N>
+struct Compiler
+{
+    CompiledPattern<N>& m_out;
+    bool m_inText{false};
+
+    constexpr void text(char ch)
+    {
+        if (!m_inText)
+        {
+            m_out.m_segments[m_out.m_count++] = Segment{0, flags::PadSpec{}, m_out.m_textSize, 0};
+            m_inText = true;
+        }
+        m_out.m_text[m_out.m_textSize++] = ch;
+        ++m_out.m_segments[m_out.m_count - 1].m_size;
+    }
+
+    constexpr void flag(char flag, flags::PadSpec pad)
+    {
+        m_out.m_segments[m_out.m_count++] = Segment{flag, pad, 0, 0};
+        m_out.m_needsTime = m_out.m_needsTime || flags::needsTime(flag);
+        m_out.m_needsElapsed = m_out.m_needsElapsed || flags::isElapsed(flag);
+        m_inText = false;
+    }
+};
+
+// 与 PatternFormatter 使用同一个解析函数
+template <size_t N>
+constexpr CompiledPattern<N> compile(const char* pattern)
+{
+    CompiledPattern<N> out{};
+    Compiler<N> compiler{out};
+    flags::parsePattern(pattern, pattern + (N - 1), compiler);
+    return out;
+}
+
+}
+}
+
+// StaticPatternFormatter: pattern 在编译期解析的格式化器
+//   - 每个占位符展开为一次内联调用,相邻的普通文本合并为一次 append,没有虚函数分派和堆上的 flag 对象
+//   - 只在 pattern 含有时间占位符时才换算时间,TimeType 为 Utc 时不读取本地时区
+//   - 支持与 PatternFormatter 相同的宽度说明(%8l、%-8l、%=8l、%8!l)
+//   - 输出与相同 pattern 的 PatternFormatter 逐字节一致
+//
+// C++17 不能直接用字符串字面量作模板参数,pattern 需要是静态存储期的 constexpr 字符数组:
+//   static constexpr char kPattern[] = "[%Y-%m-%d %H:%M:%S] [%l] %v";
+//   sink->setFormatter(std::make_unique<StaticPatternFormatter<kPattern>>());
+template <const char* Pattern, PatternTimeType TimeType = PatternTimeType::Local>
+class StaticPatternFormatter final : public Formatter
+{
+public:
+    void format(const details::LogMsg& msg, fmt::memory_buffer& dest) override
+    {
+        dest.reserve(dest.size() + 256); // 预留空间，避免多次内存分配
+
+        if constexpr (COMPILED.m_needsTime)
+        {
+            auto secs = std::chrono::floor<std::chrono::seconds>(msg.m_timePoint.time_since_epoch()); // 与秒以下占位符一致,1970 年之前也向下取整
+            if (secs != m_lastTimeSec)
+            {
+                details::toCalendar(secs.count(), TimeType, m_offsetCache, m_cachedTm, m_utcOffset);
+                m_lastTimeSec = secs;
+            }
+        }
+
+        if constexpr (COMPILED.m_needsElapsed)
+        {
+            int64_t elapsedNs = m_hasLastMsg ?
+                std::chrono::duration_cast<std::chrono::nanoseconds>(msg.m_timePoint - m_lastMsgTime).count() : 0;
+            m_elapsedNs = elapsedNs > 0 ? elapsedNs : 0;
+            m_lastMsgTime = msg.m_timePoint;
+            m_hasLastMsg = true;
+        }
+
+        formatSegments(msg, dest, std::make_index_sequence<COMPILED.m_count>());
+        dest.push_back('\n');
+    }
+
+    std::unique_ptr<Formatter> clone() const override
+    {
+        return std::make_unique<StaticPatternFormatter>(*this);
+    }
+
+private:
+    static constexpr size_t PATTERN_SIZE = details::static_pattern::length(Pattern) + 1;
+    static constexpr details::static_pattern::CompiledPattern<PATTERN_SIZE> COMPILED =
+        details::static_pattern::compile<PATTERN_SIZE>(Pattern);
+
+    template <size_t... I>
+    void formatSegments(const details::LogMsg& msg, fmt::memory_buffer& dest, std::index_sequence<I...>)
+    {
+        (formatSegment<I>(msg, dest), ...);
+    }
+
+    template <size_t I>
+    void formatSegment(const details::LogMsg& msg, fmt::memory_buffer& dest)
+    {
+        constexpr details::static_pattern::Segment seg = COMPILED.m_segments[I];
+        if constexpr (seg.m_flag == 0)
+        {
+            dest.append(COMPILED.m_text + seg.m_offset, COMPILED.m_text + seg.m_offset + seg.m_size);
+        }
+        else if constexpr (seg.m_pad.m_width == 0)
+        {
+            formatFlag<seg.m_flag>(msg, dest);
+        }
+        else
+        {
+            size_t start = dest.size();
+            formatFlag<seg.m_flag>(msg, dest);
+            details::flags::applyPadding(dest, start, seg.m_pad);
+        }
+    }
+
+    template <char Flag>
+    void formatFlag(const details::LogMsg& msg, fmt::memory_buffer& dest)
+    {
+        if constexpr (Flag == 'Y') { details::flags::year(m_cachedTm, dest); }
+        else if constexpr (Flag == 'm') { details::flags::month(m_cachedTm, dest); }
+        else if constexpr (Flag == 'd') { details::flags::day(m_cachedTm, dest); }
+        else if constexpr (Flag == 'H') { details::flags::hour(m_cachedTm, dest); }
+        else if constexpr (Flag == 'M') { details::flags::minute(m_cachedTm, dest); }
+        else if constexpr (Flag == 'S') { details::flags::second(m_cachedTm, dest); }
+        else if constexpr (Flag == 'z') { details::flags::utcOffset(m_utcOffset, dest); }
+        else if constexpr (Flag == 't') { details::flags::threadId(msg, dest); }
+        else if constexpr (Flag == 'l') { details::flags::levelShort(msg, dest); }
+        else if constexpr (Flag == 'L') { details::flags::levelFull(msg, dest); }
+        else if constexpr (Flag == 'n') { details::flags::loggerName(msg, dest); }
+        else if constexpr (Flag == 'v') { details::flags::payload(msg, dest); }
+        else if constexpr (Flag == 'N') { details::flags::sequence(msg, dest); }
+        else if constexpr (details::flags::isSubsecond(Flag)) { details::flags::subsecond(Flag, msg, dest); }
+        else if constexpr (details::flags::isElapsed(Flag)) { details::flags::elapsed(Flag, m_elapsedNs, dest); }
+    }
+
+    //时间缓存
+    std::chrono::seconds m_lastTimeSec{std::chrono::seconds::min()};
+    std::tm m_cachedTm{};
+    int32_t m_utcOffset{0};
+    details::UtcOffsetCache m_offsetCache;
+
+    //距上一条消息的时间
+    bool m_hasLastMsg{false};
+    LogClock::time_point m_lastMsgTime;
+    int64_t m_elapsedNs{0};
+};
+
+}
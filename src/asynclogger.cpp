@@ -1,5 +1,6 @@
 #include "minispdlog/asynclogger.h"
 #include <stdexcept>
+#include <fmt/format.h>
 
 namespace minispdlog
 {
@@ -11,9 +12,15 @@ AsyncLogger::AsyncLogger(
     AsyncOverflowPolicy overflowPolicy
 )
     : Logger(name, singSink), 
-        m_threadPool(threadPool), 
+        m_threadPool(threadPool.lock()), 
         m_overflowPolicy(overflowPolicy)
-{}
+{
+    if(!m_threadPool)
+    {
+        throw std::runtime_error("ThreadPool is no longer available");
+    }
+    m_shard = m_threadPool->defaultShard(m_name, m_sinks);
+}
 
 
 AsyncLogger::AsyncLogger(
@@ -23,40 +30,295 @@ AsyncLogger::AsyncLogger(
     AsyncOverflowPolicy overflowPolicy
 )
     : Logger(name, std::move(sinks)), 
-        m_threadPool(threadPool), 
+        m_threadPool(threadPool.lock()), 
         m_overflowPolicy(overflowPolicy)
-{}
+{
+    if(!m_threadPool)
+    {
+        throw std::runtime_error("ThreadPool is no longer available");
+    }
+    m_shard = m_threadPool->defaultShard(m_name, m_sinks);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    // 队列中的消息只持有本 logger 的裸指针,必须等它们全部处理完
+    try
+    {
+        m_threadPool->barrier(this);
+    }
+    catch(...)
+    {
+    }
+}
 
 void AsyncLogger::sinkLog(const details::LogMsg& msg)
 {
-    if(auto pool = m_threadPool.lock())
+    bool posted = true;
+    if(m_threadPool->hasPriorityLane())
     {
-        // 异步投递日志消息
-        if(m_overflowPolicy == AsyncOverflowPolicy::Block)
+        // 优先通道打乱了写出顺序,给每条消息编号以便还原
+        details::LogMsg sequenced(msg);
+        sequenced.m_sequence = m_threadPool->nextSequence();
+        if(msg.m_level >= m_priorityLevel)
         {
-            pool->post(shared_from_this(), msg);
+            // 优先通道的消息不受配额限制,但同样计入在途数
+            if(quotaEnabled())
+            {
+                m_inFlight.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_threadPool->postPriority(this, sequenced);
         }
         else
         {
-            pool->postNoWait(shared_from_this(), msg);
+            posted = postWithPolicy(sequenced);
         }
     }
     else
     {
-        throw std::runtime_error("ThreadPool is no longer available");
+        posted = postWithPolicy(msg);
+    }
+
+    if(!posted)
+    {
+        recordDropped(msg);
+    }
+    else if(m_droppedPending.load(std::memory_order_relaxed) > 0)
+    {
+        reportDropped(false);
+    }
+}
+
+bool AsyncLogger::postWithPolicy(const details::LogMsg& msg)
+{
+    // 先占用本 logger 的配额:超出配额与队列满按同一策略处理
+    bool useQuota = quotaEnabled();
+    if(useQuota)
+    {
+        bool acquired;
+        switch(m_overflowPolicy)
+        {
+            case AsyncOverflowPolicy::Block:
+                acquired = acquireQuota(true, std::chrono::milliseconds::max());
+                break;
+            case AsyncOverflowPolicy::BlockTimeout:
+                acquired = acquireQuota(true, m_overflowTimeout);
+                break;
+            case AsyncOverflowPolicy::LevelProtected:
+                acquired = acquireQuota(msg.m_level >= m_protectedLevel, std::chrono::milliseconds::max());
+                break;
+            default:
+                acquired = acquireQuota(false, std::chrono::milliseconds(0));
+                break;
+        }
+        if(!acquired)
+        {
+            return false;
+        }
+    }
+
+    // 异步投递日志消息
+    bool posted = true;
+    switch(m_overflowPolicy)
+    {
+        case AsyncOverflowPolicy::Block:
+            m_threadPool->post(this, msg);
+            break;
+        case AsyncOverflowPolicy::Overwrite:
+            m_threadPool->postNoWait(this, msg);
+            break;
+        case AsyncOverflowPolicy::DiscardNew:
+            posted = m_threadPool->tryPost(this, msg);
+            break;
+        case AsyncOverflowPolicy::BlockTimeout:
+            posted = m_threadPool->postFor(this, msg, m_overflowTimeout);
+            break;
+        case AsyncOverflowPolicy::LevelProtected:
+            if(msg.m_level >= m_protectedLevel)
+            {
+                m_threadPool->post(this, msg);
+            }
+            else
+            {
+                posted = m_threadPool->tryPost(this, msg);
+            }
+            break;
+    }
+
+    if(!posted && useQuota)
+    {
+        releaseQuota(1);
+    }
+    return posted;
+}
+
+bool AsyncLogger::acquireQuota(bool wait, std::chrono::milliseconds timeout)
+{
+    if(m_inFlight.fetch_add(1, std::memory_order_acq_rel) < m_queueQuota)
+    {
+        return true;
+    }
+    releaseQuota(1);
+    m_quotaHits.fetch_add(1, std::memory_order_relaxed);
+    if(!wait)
+    {
+        return false;
+    }
+
+    bool forever = timeout == std::chrono::milliseconds::max();
+    auto deadline = std::chrono::steady_clock::now() + (forever ? std::chrono::milliseconds(0) : timeout);
+
+    // 等待方持锁检查,归还方在 m_quotaWaiters 非零时持锁唤醒,不会错过通知
+    std::unique_lock<std::mutex> lock(m_quotaMutex);
+    m_quotaWaiters.fetch_add(1, std::memory_order_seq_cst);
+    bool acquired = false;
+    while(true)
+    {
+        if(m_inFlight.fetch_add(1, std::memory_order_seq_cst) < m_queueQuota)
+        {
+            acquired = true;
+            break;
+        }
+        m_inFlight.fetch_sub(1, std::memory_order_seq_cst);
+
+        if(forever)
+        {
+            m_quotaCond.wait(lock);
+        }
+        else if(m_quotaCond.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            acquired = m_inFlight.fetch_add(1, std::memory_order_seq_cst) < m_queueQuota;
+            if(!acquired)
+            {
+                m_inFlight.fetch_sub(1, std::memory_order_seq_cst);
+            }
+            break;
+        }
+    }
+    m_quotaWaiters.fetch_sub(1, std::memory_order_seq_cst);
+    return acquired;
+}
+
+void AsyncLogger::releaseQuota(size_t count)
+{
+    m_inFlight.fetch_sub(count, std::memory_order_seq_cst);
+    if(m_quotaWaiters.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_quotaMutex);
+        m_quotaCond.notify_all();
     }
 }
 
 void AsyncLogger::sinkFlush()
 {
-    if(auto pool = m_threadPool.lock())
+    if(m_droppedPending.load(std::memory_order_relaxed) > 0)
     {
-        pool->postFlush(shared_from_this());
+        reportDropped(true);
     }
-    else
+    m_threadPool->postFlush(this);
+}
+
+void AsyncLogger::recordDropped(const details::LogMsg& msg)
+{
+    m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+    m_droppedBytes.fetch_add(msg.m_payload.size(), std::memory_order_relaxed);
+    m_droppedPending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogger::reportDropped(bool force)
+{
+    if(m_dropReportInterval.count() <= 0)
     {
-        throw std::runtime_error("ThreadPool is no longer available");
+        return;
+    }
+
+    // 同一时刻只有一个线程负责报告
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t last = m_lastDropReport.load(std::memory_order_relaxed);
+    int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(m_dropReportInterval).count();
+    if(!force && now - last < interval)
+    {
+        return;
+    }
+    if(!m_lastDropReport.compare_exchange_strong(last, now, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    size_t dropped = m_droppedPending.exchange(0, std::memory_order_relaxed);
+    if(dropped == 0)
+    {
+        return;
+    }
+
+    fmt::memory_buffer buf;
+    fmt::format_to(fmt::appender(buf), "{} messages dropped because the async queue was full", dropped);
+    details::LogMsg msg(m_name, level::warn, StringView(buf.data(), buf.size()));
+    bool useQuota = quotaEnabled();
+    if(useQuota)
+    {
+        m_inFlight.fetch_add(1, std::memory_order_relaxed);
+    }
+    if(force)
+    {
+        // 刷新本来就要排队等待,报告跟在刷新前面投递,保证不会丢失
+        m_threadPool->post(this, msg);
+    }
+    else if(!m_threadPool->tryPost(this, msg))
+    {
+        // 队列仍然满,留到下次再报告
+        m_droppedPending.fetch_add(dropped, std::memory_order_relaxed);
+        if(useQuota)
+        {
+            releaseQuota(1);
+        }
+    }
+}
+
+void AsyncLogger::setShard(size_t shard)
+{
+    if(shard >= m_threadPool->shardCount())
+    {
+        throw std::invalid_argument("AsyncLogger shard must be less than ThreadPool shard count");
+    }
+    if(shard == m_shard)
+    {
+        return;
+    }
+    // 已投递到原分片的消息仍然引用本 logger,析构时只会等待新分片:先等它们处理完再切换
+    m_threadPool->barrier(this);
+    m_shard = shard;
+}
+
+std::future<void> AsyncLogger::flushAsync()
+{
+    if(m_droppedPending.load(std::memory_order_relaxed) > 0)
+    {
+        reportDropped(true);
+    }
+    details::CompletionToken completion;
+    auto future = completion.arm();
+    m_threadPool->postFlush(this, std::move(completion));
+    return future;
+}
+
+bool AsyncLogger::flushFor(std::chrono::milliseconds timeout)
+{
+    auto future = flushAsync();
+    if(future.wait_for(timeout) != std::future_status::ready)
+    {
+        return false;
+    }
+    try
+    {
+        future.get();
     }
+    catch(const std::runtime_error&)
+    {
+        return false; // 刷新请求被丢弃
+    }
+    return true;
 }
 
 void AsyncLogger::backendSinkLog(const details::LogMsg& msg)
@@ -73,6 +335,41 @@ void AsyncLogger::backendSinkLog(const details::LogMsg& msg)
     {
         backendSinkFlush();
     }
+
+    if(quotaEnabled())
+    {
+        releaseQuota(1);
+    }
+}
+
+void AsyncLogger::backendSinkLogBatch(const details::LogMsgBatch& msgs)
+{
+    for(auto& sink : m_sinks)
+    {
+        sink->logBatch(msgs);
+    }
+
+    for(const details::LogMsg* msg : msgs)
+    {
+        if(msg->m_level >= m_flushLevel)
+        {
+            backendSinkFlush();
+            break;
+        }
+    }
+
+    if(quotaEnabled())
+    {
+        releaseQuota(msgs.size());
+    }
+}
+
+void AsyncLogger::backendDiscard(size_t count)
+{
+    if(quotaEnabled())
+    {
+        releaseQuota(count);
+    }
 }
 
 void AsyncLogger::backendSinkFlush()
@@ -0,0 +1,64 @@
+#include "minispdlog/details/periodicworker.h"
+#include <stdexcept>
+
+namespace minispdlog {
+namespace details {
+
+PeriodicWorker::PeriodicWorker(std::function<void()> callback, std::chrono::milliseconds interval)
+    : m_callback(std::move(callback)),
+      m_interval(interval)
+{
+    if(interval.count() <= 0)
+    {
+        throw std::invalid_argument("PeriodicWorker interval must be greater than 0");
+    }
+    m_thread = std::thread([this]() { loop(); });
+}
+
+PeriodicWorker::~PeriodicWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_active = false;
+    }
+    m_cond.notify_one();
+    if(m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void PeriodicWorker::loop()
+{
+    // 按固定节拍执行,callback 的耗时不会累积成漂移
+    auto next = std::chrono::steady_clock::now() + m_interval;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if(m_cond.wait_until(lock, next, [this]() { return !m_active; }))
+            {
+                return;
+            }
+        }
+
+        try
+        {
+            m_callback();
+        }
+        catch(...)
+        {
+            // 后台线程里没有人能处理异常,下个周期再试
+        }
+
+        next += m_interval;
+        auto now = std::chrono::steady_clock::now();
+        if(next < now)
+        {
+            next = now + m_interval; // 落后超过一个周期时不补做
+        }
+    }
+}
+
+}
+}
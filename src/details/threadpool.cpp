@@ -1,103 +1,1544 @@
 #include "minispdlog/details/threadpool.h"
 #include "minispdlog/asynclogger.h"
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace minispdlog {
 namespace details {
 
-ThreadPool::ThreadPool(size_t queueSize, size_t threadSize)
-    : m_queue(queueSize)
+namespace {
+
+ThreadPoolOptions makeOptions(size_t queueSize, size_t threadSize, QueueType queueType)
+{
+    ThreadPoolOptions options;
+    options.queueSize = queueSize;
+    options.threadSize = threadSize;
+    options.queueType = queueType;
+    return options;
+}
+
+std::unique_ptr<AsyncQueue<AsyncMsg>> makeQueue(const ThreadPoolOptions& options, ByteRingQueue*& byteRing,
+    const std::shared_ptr<MemoryBudget>& budget)
+{
+    switch(options.queueType)
+    {
+        case QueueType::LockFree:
+            return std::make_unique<LockFreeMPMCQueue<AsyncMsg>>(options.queueSize);
+        case QueueType::PerThread:
+            return std::make_unique<PerThreadQueue<AsyncMsg>>(options.ringCapacity, options.producerExitPolicy);
+        case QueueType::ByteRing:
+        {
+            auto queue = std::make_unique<ByteRingQueue>(options.ringBytes);
+            byteRing = queue.get();
+            return queue;
+        }
+        case QueueType::Elastic:
+            return std::make_unique<ElasticQueue>(options.elasticChunkSize, budget);
+        case QueueType::Blocking:
+        default:
+            return std::make_unique<MPMCBlockingQueue<AsyncMsg>>(options.queueSize);
+    }
+}
+
+// 每个线程固定使用一个入队计数槽
+size_t producerStripe()
+{
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed);
+    return stripe;
+}
+
+uint64_t elapsedNs(LogClock::time_point from, LogClock::time_point to)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+}
+
+std::runtime_error workerSetupError(const char* what, int err)
+{
+    return std::runtime_error(std::string("ThreadPool failed to ") + what + ": " + std::strerror(err));
+}
+
+// 在工作线程内调用:按配置设置本线程的 CPU 亲和性、调度类、nice 值和名字
+void applyWorkerSettings(const ThreadPoolOptions& options, size_t index)
+{
+#ifdef __linux__
+    if(!options.workerCpuSets.empty())
+    {
+        const std::vector<int>& cpus = options.workerCpuSets[index % options.workerCpuSets.size()];
+        if(!cpus.empty())
+        {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            for(int cpu : cpus)
+            {
+                CPU_SET(cpu, &cpuSet);
+            }
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+            if(err != 0)
+            {
+                throw workerSetupError("set worker CPU affinity", err);
+            }
+        }
+    }
+
+    // 先切换调度类再设置 nice,SCHED_BATCH 下 nice 值仍然决定权重
+    if(options.workerSchedPolicy == WorkerSchedPolicy::Batch)
+    {
+        sched_param param{};
+        param.sched_priority = 0;
+        int err = pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+        if(err != 0)
+        {
+            throw workerSetupError("set worker scheduling policy", err);
+        }
+    }
+
+    if(options.workerNice != 0)
+    {
+        // Linux 的 nice 值是线程级的,按线程 id 设置
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if(setpriority(PRIO_PROCESS, static_cast<id_t>(tid), options.workerNice) != 0)
+        {
+            throw workerSetupError("set worker nice value", errno);
+        }
+    }
+
+    if(!options.threadNamePrefix.empty())
+    {
+        // 线程名最长 15 字节
+        std::string name = (options.threadNamePrefix + std::to_string(index)).substr(0, 15);
+        pthread_setname_np(pthread_self(), name.c_str());
+    }
+#else
+    (void)index;
+#endif
+
+    if(options.onThreadStart)
+    {
+        options.onThreadStart(index);
+    }
+}
+
+}
+
+ThreadPool::ThreadPool(size_t queueSize, size_t threadSize, QueueType queueType)
+    : ThreadPool(makeOptions(queueSize, threadSize, queueType))
+{}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+    : m_batchSize(options.batchSize),
+      m_batchMaxWait(options.batchMaxWait),
+      m_waitStrategy(options.waitStrategy),
+      m_shardAffinity(options.shardAffinity),
+      m_workStealing(options.workStealing && options.sharded && options.threadSize > 1),
+      m_hasPriorityLane(options.priorityQueueSize > 0),
+      m_fairQuantum(options.fairQuantum),
+      m_collectStats(options.collectStats)
 {
-    if(threadSize == 0 || threadSize > 1000)
+    if(options.threadSize == 0 || options.threadSize > 1000)
     {
         throw std::invalid_argument("ThreadPool thread size must be greater than 0 and less than or equal to 1000");
     }
 
-    if(queueSize == 0 || queueSize > 1000000)
+    if(options.batchSize == 0 || options.batchSize > 65536)
+    {
+        throw std::invalid_argument("ThreadPool batch size must be greater than 0 and less than or equal to 65536");
+    }
+
+    if(options.workStealing && options.fairQuantum > 0)
+    {
+        throw std::invalid_argument("ThreadPool work stealing cannot be combined with fair quantum");
+    }
+
+    if(options.priorityQueueSize > 1000000)
+    {
+        throw std::invalid_argument("ThreadPool priority queue size must be less than or equal to 1000000");
+    }
+
+    switch(options.queueType)
+    {
+        case QueueType::Blocking:
+        case QueueType::LockFree:
+        {
+            if(options.queueSize == 0 || options.queueSize > 1000000)
+            {
+                throw std::invalid_argument("ThreadPool queue size must be greater than 0 and less than or equal to 1000000");
+            }
+            break;
+        }
+        case QueueType::PerThread:
+        {
+            if(options.ringCapacity == 0 || options.ringCapacity > 1000000)
+            {
+                throw std::invalid_argument("ThreadPool ring capacity must be greater than 0 and less than or equal to 1000000");
+            }
+            break;
+        }
+        case QueueType::ByteRing:
+        {
+            if(options.ringBytes < 4096 || options.ringBytes > (size_t(1) << 30))
+            {
+                throw std::invalid_argument("ThreadPool ring bytes must be between 4096 and 1073741824");
+            }
+            break;
+        }
+        case QueueType::Elastic:
+        {
+            if(options.elasticChunkSize == 0 || options.elasticChunkSize > 65536)
+            {
+                throw std::invalid_argument("ThreadPool elastic chunk size must be greater than 0 and less than or equal to 65536");
+            }
+            size_t shardCount = options.sharded ? options.threadSize : 1;
+            if(options.memoryBudget / shardCount / sizeof(AsyncMsg) < options.elasticChunkSize)
+            {
+                throw std::invalid_argument("ThreadPool memory budget must hold at least one elastic chunk per shard");
+            }
+            m_memoryBudget = std::make_shared<MemoryBudget>(options.memoryBudget);
+            break;
+        }
+    }
+
+    if(options.workerNice < -20 || options.workerNice > 19)
+    {
+        throw std::invalid_argument("ThreadPool worker nice value must be between -20 and 19");
+    }
+
+#ifdef __linux__
+    for(auto& cpus : options.workerCpuSets)
+    {
+        for(int cpu : cpus)
+        {
+            if(cpu < 0 || cpu >= CPU_SETSIZE)
+            {
+                throw std::invalid_argument("ThreadPool worker CPU index out of range");
+            }
+        }
+    }
+#endif
+
+    size_t shardCount = options.sharded ? options.threadSize : 1;
+    for(size_t i = 0; i < shardCount; ++i)
+    {
+        auto shard = std::make_unique<Shard>();
+        shard->m_queue = makeQueue(options, shard->m_byteRing, m_memoryBudget);
+        // 被覆盖淘汰的消息同样要归还配额、完成屏障,否则限额的 logger 会一直等待这些永远不会写出的消息
+        shard->m_queue->setEvictionHandler(&ThreadPool::releaseMsg);
+        if(m_hasPriorityLane)
+        {
+            shard->m_priorityQueue = std::make_unique<LockFreeMPMCQueue<AsyncMsg>>(options.priorityQueueSize);
+            shard->m_priorityQueue->setEvictionHandler(&ThreadPool::releaseMsg);
+        }
+        m_shards.push_back(std::move(shard));
+    }
+
+    m_workerEpochs.reset(new WorkerEpoch[options.threadSize]);
+    m_workerStats.reset(new WorkerStats[options.threadSize]);
+    for(size_t i = 0; i < options.threadSize; ++i)
     {
-        throw std::invalid_argument("ThreadPool queue size must be greater than 0 and less than or equal to 1000000");
+        m_shards[i % shardCount]->m_workerIndices.push_back(i);
     }
 
-    for(size_t i = 0; i < threadSize; ++i)
+    // 每个工作线程先完成线程级设置再进入循环,构造函数等所有线程都设置完才返回,失败时把异常带回来
+    std::vector<std::promise<void>> started(options.threadSize);
+    std::vector<std::future<void>> startedFutures;
+    for(auto& promise : started)
     {
-        m_workers.emplace_back([this]() { loop(); });
+        startedFutures.push_back(promise.get_future());
+    }
+    for(size_t i = 0; i < options.threadSize; ++i)
+    {
+        m_workers.emplace_back([this, i, &options, &started]() {
+            try
+            {
+                applyWorkerSettings(options, i);
+            }
+            catch(...)
+            {
+                started[i].set_exception(std::current_exception());
+                workerExited();
+                return;
+            }
+            started[i].set_value();
+            loop(i);
+            workerExited();
+        });
+    }
+
+    std::exception_ptr error;
+    for(auto& future : startedFutures)
+    {
+        try
+        {
+            future.get();
+        }
+        catch(...)
+        {
+            if(!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if(error)
+    {
+        shutdown(ShutdownMode::Discard);
+        finishStop();
+        std::rethrow_exception(error);
     }
 }
 
 ThreadPool::~ThreadPool()
 {
-    for(size_t i = 0; i < m_workers.size(); ++i)
+    shutdown(ShutdownMode::DrainAll);
+    // shutdown 因 sink 卡住提前返回时,这里只能继续等待
+    finishStop();
+}
+
+ShutdownResult ThreadPool::shutdown(ShutdownMode mode, std::chrono::milliseconds timeout)
+{
+    // 截止时间先于模式写入;重复调用只能收紧处理方式,DrainUntil 取更早的截止时间
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    if(mode == ShutdownMode::DrainUntil)
+    {
+        int64_t deadlineNs = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        int64_t current = m_stopDeadline.load(std::memory_order_relaxed);
+        while((current == 0 || deadlineNs < current)
+            && !m_stopDeadline.compare_exchange_weak(current, deadlineNs, std::memory_order_relaxed))
+        {
+        }
+    }
+    int request = static_cast<int>(mode) + 1;
+    int current = m_stopRequest.load(std::memory_order_relaxed);
+    while(request > current && !m_stopRequest.compare_exchange_weak(current, request, std::memory_order_acq_rel))
+    {
+    }
+    bool untilDeadline = static_cast<ShutdownMode>(std::max(request, current) - 1) == ShutdownMode::DrainUntil;
+    if(untilDeadline)
+    {
+        deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(m_stopDeadline.load(std::memory_order_relaxed)));
+    }
+
+    // 唤醒挂起的工作线程;队列已满说明工作线程没有挂起,不必等待空位
+    for(auto& shard : m_shards)
     {
-        AsyncMsg terminateMsg(AsyncMsgType::Shutdown);
-        m_queue.enqueue(std::move(terminateMsg));
+        for(size_t i = 0; i < shard->m_workerIndices.size(); ++i)
+        {
+            if(shard->m_queue->tryEnqueue(AsyncMsg(AsyncMsgType::Shutdown)))
+            {
+                countEnqueued();
+            }
+        }
     }
 
-    for(auto& worker : m_workers)
+    ShutdownResult result;
     {
-        if(worker.joinable())
+        std::unique_lock<std::mutex> lock(m_stopMutex);
+        size_t lastProgress = m_drainedCount.load(std::memory_order_relaxed) + m_discardedCount.load(std::memory_order_relaxed);
+        auto lastChange = std::chrono::steady_clock::now();
+        while(m_exitedWorkers < m_workers.size())
         {
-            worker.join();
+            m_stopCond.wait_for(lock, std::chrono::milliseconds(10));
+            if(!untilDeadline)
+            {
+                continue;
+            }
+
+            // 到期之后工作线程只丢弃不写出,很快就会退出;长时间没有任何进展说明卡在了 sink 中
+            auto now = std::chrono::steady_clock::now();
+            size_t progress = m_drainedCount.load(std::memory_order_relaxed) + m_discardedCount.load(std::memory_order_relaxed);
+            if(progress != lastProgress)
+            {
+                lastProgress = progress;
+                lastChange = now;
+            }
+            else if(now >= deadline && now - std::max(lastChange, deadline) >= SHUTDOWN_STALL_TIMEOUT)
+            {
+                break;
+            }
         }
+        result.completed = m_exitedWorkers == m_workers.size();
+    }
+
+    if(result.completed)
+    {
+        finishStop();
     }
+    result.drained = m_drainedCount.load(std::memory_order_relaxed);
+    result.discarded = m_discardedCount.load(std::memory_order_relaxed);
+    return result;
 }
 
-void ThreadPool::post(std::shared_ptr<AsyncLogger>&& logger, const LogMsg& msg)
+void ThreadPool::finishStop()
 {
-    AsyncMsg asyncMsg(AsyncMsgType::Log, std::move(logger), msg);
-    m_queue.enqueue(std::move(asyncMsg));
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        for(auto& worker : m_workers)
+        {
+            if(worker.joinable())
+            {
+                worker.join();
+            }
+        }
+    }
+
+    // 最后一个退出的线程可能还留有等待其他线程的刷新请求,此时所有纪元都已是偶数
+    completePendingFlushes();
+
+    // 与投递方的检查配对:要么投递方看到 m_stopped 自己清理,要么这里的清理能看到它投递的消息
+    m_stopped.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drainDiscard();
 }
 
-void ThreadPool::postNoWait(std::shared_ptr<AsyncLogger>&& logger, const LogMsg& msg)
+void ThreadPool::workerExited()
 {
-    AsyncMsg asyncMsg(AsyncMsgType::Log, std::move(logger), msg);
-    m_queue.enqueueNoWait(std::move(asyncMsg));
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        ++m_exitedWorkers;
+    }
+    m_stopCond.notify_all();
 }
 
-void ThreadPool::postFlush(std::shared_ptr<AsyncLogger>&& logger)
+bool ThreadPool::shouldDiscard() const
 {
-    AsyncMsg asyncMsg(AsyncMsgType::Flush, std::move(logger));
-    m_queue.enqueue(std::move(asyncMsg));
+    auto mode = static_cast<ShutdownMode>(m_stopRequest.load(std::memory_order_acquire) - 1);
+    if(mode == ShutdownMode::Discard)
+    {
+        return true;
+    }
+    if(mode == ShutdownMode::DrainUntil)
+    {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return now >= m_stopDeadline.load(std::memory_order_relaxed);
+    }
+    return false;
 }
 
-void ThreadPool::loop()
+void ThreadPool::discardMsgs(std::vector<AsyncMsg>& msgs)
 {
-    while(processNextMsg()){}
+    for(auto& msg : msgs)
+    {
+        if(msg.m_type == AsyncMsgType::Log)
+        {
+            m_discardedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        releaseMsg(msg);
+    }
+    msgs.clear();
 }
 
-bool ThreadPool::processNextMsg()
+void ThreadPool::releaseMsg(AsyncMsg& msg)
 {
-    AsyncMsg msg;
-    if(!m_queue.dequeueFor(msg, std::chrono::milliseconds(10)))
-        return true; // 没有消息，继续等待
-    
     switch(msg.m_type)
     {
         case AsyncMsgType::Log:
         {
             if(msg.m_workerPtr)
             {
-                // 调用 AsyncLogger 的 backendSinkLog
-                msg.m_workerPtr->backendSinkLog(msg);
+                msg.m_workerPtr->backendDiscard(1);
             }
-            return true;
+            break;
         }
-        case AsyncMsgType::Flush:
+        case AsyncMsgType::Barrier:
         {
-            if(msg.m_workerPtr)
-            {
+            msg.m_completion.complete();
+            break;
+        }
+        default:
+            break; // Flush 之前的消息没有全部写出,随消息析构收到异常
+    }
+}
 
-                msg.m_workerPtr->backendSinkFlush();
+void ThreadPool::drainDiscard()
+{
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    std::vector<AsyncMsg> msgs;
+    for(auto& shard : m_shards)
+    {
+        while(size_t count = shard->m_queue->tryDequeueBulk(msgs, m_batchSize))
+        {
+            countDequeued(0, count);
+            discardMsgs(msgs);
+        }
+        if(shard->m_priorityQueue)
+        {
+            while(size_t count = shard->m_priorityQueue->tryDequeueBulk(msgs, m_batchSize))
+            {
+                countDequeued(0, count);
+                discardMsgs(msgs);
             }
-            return true;
         }
-        case AsyncMsgType::Shutdown:
+    }
+}
+
+void ThreadPool::discardPost(AsyncLogger* logger)
+{
+    m_discardedCount.fetch_add(1, std::memory_order_relaxed);
+    if(logger)
+    {
+        logger->backendDiscard(1);
+    }
+}
+
+ThreadPool::Shard& ThreadPool::shardOf(const AsyncLogger* logger)
+{
+    if(m_shards.size() == 1 || logger == nullptr)
+    {
+        return *m_shards[0];
+    }
+    return *m_shards[logger->m_shard % m_shards.size()];
+}
+
+size_t ThreadPool::defaultShard(const std::string& loggerName, const std::vector<sinks::SinkPtr>& sinks) const
+{
+    if(m_shards.size() == 1)
+    {
+        return 0;
+    }
+
+    size_t hash;
+    if(m_shardAffinity == ShardAffinity::SinkSet && !sinks.empty())
+    {
+        // 与 sink 的顺序无关:同一组 sink 无论以什么顺序添加都映射到同一分片
+        hash = 0;
+        for(auto& sink : sinks)
         {
-            // 处理关闭消息，退出循环
-            return false;
+            hash += std::hash<const sinks::Sink*>()(sink.get());
         }
     }
-    return true; // 默认继续处理
+    else
+    {
+        hash = std::hash<std::string>()(loggerName);
+    }
+    return hash % m_shards.size();
+}
+
+size_t ThreadPool::overrunCount()
+{
+    size_t total = 0;
+    for(auto& shard : m_shards)
+    {
+        total += shard->m_queue->overrunCount();
+    }
+    return total;
+}
+
+ThreadPoolStats ThreadPool::stats() const
+{
+    ThreadPoolStats result;
+    uint64_t overrun = totalOverrun();
+    result.overrunCount = overrun - m_overrunBase.load(std::memory_order_relaxed);
+    if(!m_collectStats)
+    {
+        return result;
+    }
+
+    // 先读出队计数再读入队计数,并发时 depth 只会偏大不会下溢
+    uint64_t dequeued = totalDequeued();
+    uint64_t enqueued = totalEnqueued();
+    result.depth = enqueued > dequeued + overrun ? static_cast<size_t>(enqueued - dequeued - overrun) : 0;
+    result.highWaterMark = std::max(m_highWaterMark.load(std::memory_order_relaxed), result.depth);
+    result.enqueueCount = enqueued - m_enqueueBase.load(std::memory_order_relaxed);
+    result.dequeueCount = dequeued - m_dequeueBase.load(std::memory_order_relaxed);
+    result.blockCount = m_blockCount.load(std::memory_order_relaxed);
+    result.blockTimeNs = m_blockTimeNs.load(std::memory_order_relaxed);
+    result.maxBlockNs = m_maxBlockNs.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workerStats[i].m_residency.addTo(result.residency);
+    }
+    return result;
+}
+
+void ThreadPool::resetStats()
+{
+    // 计数器本身不清零,记下当前累计值作为基准,depth 的计算不受影响
+    uint64_t overrun = totalOverrun();
+    uint64_t dequeued = totalDequeued();
+    uint64_t enqueued = totalEnqueued();
+    m_overrunBase.store(overrun, std::memory_order_relaxed);
+    m_dequeueBase.store(dequeued, std::memory_order_relaxed);
+    m_enqueueBase.store(enqueued, std::memory_order_relaxed);
+    m_highWaterMark.store(enqueued > dequeued + overrun ? static_cast<size_t>(enqueued - dequeued - overrun) : 0,
+        std::memory_order_relaxed);
+    m_blockCount.store(0, std::memory_order_relaxed);
+    m_blockTimeNs.store(0, std::memory_order_relaxed);
+    m_maxBlockNs.store(0, std::memory_order_relaxed);
+    for(size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workerStats[i].m_residency.reset();
+    }
+}
+
+void ThreadPool::enqueueBlocking(AsyncQueue<AsyncMsg>& queue, AsyncMsg&& msg)
+{
+    if(!m_collectStats)
+    {
+        queue.enqueue(std::move(msg));
+        return;
+    }
+    // tryEnqueue 失败时 msg 保持原样
+    if(!queue.tryEnqueue(std::move(msg)))
+    {
+        auto start = std::chrono::steady_clock::now();
+        queue.enqueue(std::move(msg));
+        recordBlocked(start);
+    }
+    countEnqueued();
+}
+
+void ThreadPool::recordBlocked(std::chrono::steady_clock::time_point start)
+{
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    m_blockCount.fetch_add(1, std::memory_order_relaxed);
+    m_blockTimeNs.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t maxNs = m_maxBlockNs.load(std::memory_order_relaxed);
+    while(ns > maxNs && !m_maxBlockNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void ThreadPool::countEnqueued(size_t count)
+{
+    if(m_collectStats)
+    {
+        m_enqueueCounts[producerStripe() % STAT_STRIPES].m_value.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+uint64_t ThreadPool::totalEnqueued() const
+{
+    uint64_t total = 0;
+    for(auto& counter : m_enqueueCounts)
+    {
+        total += counter.m_value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t ThreadPool::totalDequeued() const
+{
+    uint64_t total = 0;
+    for(size_t i = 0; i < m_workers.size(); ++i)
+    {
+        total += m_workerStats[i].m_dequeued.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t ThreadPool::totalOverrun() const
+{
+    uint64_t total = 0;
+    for(auto& shard : m_shards)
+    {
+        total += shard->m_queue->overrunCount();
+    }
+    return total;
+}
+
+void ThreadPool::countDequeued(size_t workerIndex, size_t count)
+{
+    if(!m_collectStats || count == 0)
+    {
+        return;
+    }
+    m_workerStats[workerIndex].m_dequeued.fetch_add(count, std::memory_order_relaxed);
+
+    // 取出之后采样:剩余深度与本次取出数量中较大的一个
+    // 取出时唤醒的生产者可能立刻补满队列,用二者之和会把这些新消息重复算进去
+    uint64_t dequeued = totalDequeued();
+    uint64_t overrun = totalOverrun();
+    uint64_t enqueued = totalEnqueued();
+    size_t depth = enqueued > dequeued + overrun ? static_cast<size_t>(enqueued - dequeued - overrun) : 0;
+    depth = std::max(depth, count);
+    size_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+    while(depth > highWaterMark && !m_highWaterMark.compare_exchange_weak(highWaterMark, depth, std::memory_order_relaxed))
+    {
+    }
+}
+
+void ThreadPool::recordResidency(WorkerContext& ctx)
+{
+    if(!m_collectStats)
+    {
+        return;
+    }
+    // 整批共用一次取时:批内消息都在这之前写完
+    auto now = LogClock::now();
+    auto& residency = m_workerStats[ctx.m_index].m_residency;
+    for(auto& msg : ctx.m_batch)
+    {
+        if(msg.m_type == AsyncMsgType::Log)
+        {
+            residency.record(elapsedNs(msg.m_timePoint, now));
+        }
+    }
+}
+
+void ThreadPool::post(AsyncLogger* logger, const LogMsg& msg)
+{
+    if(stopRequested())
+    {
+        discardPost(logger);
+        return;
+    }
+    Shard& shard = shardOf(logger);
+    // 字节环直接拷贝 LogMsg,省掉中间 AsyncMsg 的构造
+    if(shard.m_byteRing)
+    {
+        if(!m_collectStats)
+        {
+            shard.m_byteRing->enqueueRecord(AsyncMsgType::Log, logger, msg);
+            return;
+        }
+        if(!shard.m_byteRing->tryEnqueueRecord(AsyncMsgType::Log, logger, msg))
+        {
+            auto start = std::chrono::steady_clock::now();
+            shard.m_byteRing->enqueueRecord(AsyncMsgType::Log, logger, msg);
+            recordBlocked(start);
+        }
+        countEnqueued();
+        return;
+    }
+    AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+    enqueueBlocking(*shard.m_queue, std::move(asyncMsg));
+}
+
+void ThreadPool::postNoWait(AsyncLogger* logger, const LogMsg& msg)
+{
+    if(stopRequested())
+    {
+        discardPost(logger);
+        return;
+    }
+    Shard& shard = shardOf(logger);
+    if(shard.m_byteRing)
+    {
+        shard.m_byteRing->enqueueRecordNoWait(AsyncMsgType::Log, logger, msg);
+    }
+    else
+    {
+        AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+        shard.m_queue->enqueueNoWait(std::move(asyncMsg));
+    }
+    countEnqueued();
+}
+
+bool ThreadPool::tryPost(AsyncLogger* logger, const LogMsg& msg)
+{
+    if(stopRequested())
+    {
+        return false;
+    }
+    Shard& shard = shardOf(logger);
+    bool posted;
+    if(shard.m_byteRing)
+    {
+        posted = shard.m_byteRing->tryEnqueueRecord(AsyncMsgType::Log, logger, msg);
+    }
+    else if(shard.m_queue->approxFull())
+    {
+        // 队列已满时不拷贝 payload(长消息需要堆分配),直接放弃
+        posted = false;
+    }
+    else
+    {
+        AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+        posted = shard.m_queue->tryEnqueue(std::move(asyncMsg));
+    }
+    if(posted)
+    {
+        countEnqueued();
+    }
+    return posted;
+}
+
+bool ThreadPool::postFor(AsyncLogger* logger, const LogMsg& msg, std::chrono::milliseconds timeout)
+{
+    if(stopRequested())
+    {
+        return false;
+    }
+    Shard& shard = shardOf(logger);
+    bool posted;
+    if(!m_collectStats)
+    {
+        if(shard.m_byteRing)
+        {
+            return shard.m_byteRing->enqueueRecordFor(AsyncMsgType::Log, logger, msg, timeout);
+        }
+        AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+        return shard.m_queue->enqueueFor(std::move(asyncMsg), timeout);
+    }
+
+    if(shard.m_byteRing)
+    {
+        posted = shard.m_byteRing->tryEnqueueRecord(AsyncMsgType::Log, logger, msg);
+        if(!posted)
+        {
+            auto start = std::chrono::steady_clock::now();
+            posted = shard.m_byteRing->enqueueRecordFor(AsyncMsgType::Log, logger, msg, timeout);
+            recordBlocked(start);
+        }
+    }
+    else
+    {
+        AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+        posted = shard.m_queue->tryEnqueue(std::move(asyncMsg));
+        if(!posted)
+        {
+            auto start = std::chrono::steady_clock::now();
+            posted = shard.m_queue->enqueueFor(std::move(asyncMsg), timeout);
+            recordBlocked(start);
+        }
+    }
+    if(posted)
+    {
+        countEnqueued();
+    }
+    return posted;
+}
+
+void ThreadPool::postPriority(AsyncLogger* logger, const LogMsg& msg)
+{
+    Shard& shard = shardOf(logger);
+    if(!shard.m_priorityQueue || stopRequested())
+    {
+        post(logger, msg);
+        return;
+    }
+    AsyncMsg asyncMsg(AsyncMsgType::Log, logger, msg);
+    enqueueBlocking(*shard.m_priorityQueue, std::move(asyncMsg));
+
+    // 工作线程可能正挂起在普通队列上;普通队列满说明它没有挂起,唤醒消息可以丢弃
+    if(shard.m_queue->tryEnqueue(AsyncMsg(AsyncMsgType::Wakeup)))
+    {
+        countEnqueued();
+    }
+}
+
+void ThreadPool::postFlush(AsyncLogger* logger, CompletionToken&& completion)
+{
+    // 关闭之后没有工作线程,在调用线程中直接刷新
+    if(m_stopped.load(std::memory_order_seq_cst))
+    {
+        if(logger)
+        {
+            logger->backendSinkFlush();
+        }
+        completion.complete();
+        return;
+    }
+    AsyncMsg asyncMsg(AsyncMsgType::Flush, logger);
+    asyncMsg.m_completion = std::move(completion);
+    enqueueBlocking(*shardOf(logger).m_queue, std::move(asyncMsg));
+
+    // 入队时线程池恰好关闭完成:消息不会再被处理,自己清理(刷新请求收到异常)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_stopped.load(std::memory_order_seq_cst))
+    {
+        drainDiscard();
+    }
+}
+
+void ThreadPool::barrier(const AsyncLogger* logger)
+{
+    // 关闭之后没有工作线程,清理掉队列中剩下的消息即可,之后不会再访问 logger
+    if(m_stopped.load(std::memory_order_seq_cst))
+    {
+        drainDiscard();
+        return;
+    }
+
+    Shard& shard = shardOf(logger);
+    AsyncMsg barrierMsg(AsyncMsgType::Barrier);
+    auto future = barrierMsg.m_completion.arm();
+    enqueueBlocking(*shard.m_queue, std::move(barrierMsg));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_stopped.load(std::memory_order_seq_cst))
+    {
+        drainDiscard();
+    }
+    future.wait();
+
+    // barrier 之前的消息都已被取出,但同一分片的其他工作线程可能还在处理更早取出的批次
+    // 等待所有处于奇数纪元的工作线程结束当前这一轮;挂起等待消息的线程处于偶数纪元,不必等它
+    for(size_t i : shard.m_workerIndices)
+    {
+        auto& epoch = m_workerEpochs[i].m_value;
+        uint64_t current = epoch.load(std::memory_order_seq_cst);
+        if(current % 2 == 0)
+        {
+            continue;
+        }
+        // 与 leaveEpoch 配对:要么工作线程看到等待者并唤醒,要么这里看到纪元已经变化
+        m_epochWaiters.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(m_epochMutex);
+            m_epochCond.wait(lock, [&epoch, current]() {
+                return epoch.load(std::memory_order_seq_cst) != current;
+            });
+        }
+        m_epochWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 生产者覆盖淘汰时可能刚取出本 logger 更早的消息、还没有归还配额(无锁队列先出队后处理),等它处理完
+    while(shard.m_queue->evictionsInFlight() > 0
+        || (shard.m_priorityQueue && shard.m_priorityQueue->evictionsInFlight() > 0))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::loop(size_t index)
+{
+    WorkerContext ctx;
+    ctx.m_index = index;
+    ctx.m_shard = m_shards[index % m_shards.size()].get();
+    ctx.m_batch.reserve(m_batchSize);
+    ctx.m_logMsgs.reserve(m_batchSize);
+
+    // 纪元的进出在 takeBatch/leaveEpoch 中:只有取到消息的这段时间处于奇数纪元
+    while(processNextBatch(ctx))
+    {
+    }
+}
+
+bool ThreadPool::processNextBatch(WorkerContext& ctx)
+{
+    auto& batch = ctx.m_batch;
+    // 关闭过程中不再等待,取不到消息说明本分片已经排空,退出
+    bool stopping = stopRequested();
+    size_t count = stopping ? takeBatch(ctx, false) : waitForBatch(ctx);
+    if(count == 0)
+        return !stopping; // 没有消息，继续等待
+
+    if(stopping)
+    {
+        if(shouldDiscard())
+        {
+            discardMsgs(batch);
+            leaveEpoch(ctx.m_index);
+            return true;
+        }
+        size_t logCount = std::count_if(batch.begin(), batch.end(),
+            [](const AsyncMsg& msg) { return msg.m_type == AsyncMsgType::Log; });
+        m_drainedCount.fetch_add(logCount, std::memory_order_relaxed);
+    }
+
+    formatDeferred(ctx);
+
+    // 以控制消息为界切分,连续的 Log 消息整段分发
+    size_t segmentBegin = 0;
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        AsyncMsg& msg = batch[i];
+        if(msg.m_type == AsyncMsgType::Log || msg.m_type == AsyncMsgType::Wakeup)
+        {
+            continue; // Wakeup 不属于任何 logger,分发时自然被跳过
+        }
+
+        dispatchLogMsgs(ctx, segmentBegin, i);
+        segmentBegin = i + 1;
+
+        switch(msg.m_type)
+        {
+            case AsyncMsgType::Flush:
+            {
+                handleFlush(ctx, msg);
+                break;
+            }
+            case AsyncMsgType::Shutdown:
+            {
+                break; // 只用来唤醒挂起的工作线程,是否退出看 m_stopRequest
+            }
+            case AsyncMsgType::Barrier:
+            {
+                msg.m_completion.complete();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    dispatchLogMsgs(ctx, segmentBegin, batch.size());
+    recordResidency(ctx);
+    leaveEpoch(ctx.m_index);
+    return true;
+}
+
+size_t ThreadPool::takeBatch(WorkerContext& ctx, bool fill)
+{
+    auto& batch = ctx.m_batch;
+    Shard& shard = *ctx.m_shard;
+    batch.clear();
+
+    // 先进入奇数纪元再出队:Flush/Barrier 看到某个线程处于偶数纪元时,它一定没有持有排在它们之前的消息
+    m_workerEpochs[ctx.m_index].m_value.fetch_add(1, std::memory_order_seq_cst);
+    size_t count = shard.m_queue->tryDequeueBulk(batch, m_batchSize);
+    countDequeued(ctx.m_index, count);
+
+    if(fill && count > 0 && m_batchMaxWait.count() > 0)
+    {
+        auto deadline = std::chrono::steady_clock::now() + m_batchMaxWait;
+        while(batch.size() < m_batchSize)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            size_t more = remaining.count() <= 0 ? 0 : shard.m_queue->dequeueBulkFor(batch, m_batchSize - batch.size(), remaining);
+            if(more == 0)
+            {
+                break;
+            }
+            countDequeued(ctx.m_index, more);
+        }
+    }
+
+    // 优先通道的消息排到本批最前面
+    // 在取出普通消息之后再检查:投递方先写优先通道、后写普通队列的 Flush/Barrier 一定排在它们后面
+    if(auto* priorityQueue = shard.m_priorityQueue.get())
+    {
+        // 本批含 Flush/Barrier 时必须把优先通道取空,否则它们完成时更早的优先消息还留在通道里
+        // (~AsyncLogger 返回后这些消息持有悬空的 logger 指针);不足一批说明通道已空
+        bool hasMarker = std::any_of(batch.begin(), batch.end(), [](const AsyncMsg& msg) {
+            return msg.m_type == AsyncMsgType::Flush || msg.m_type == AsyncMsgType::Barrier;
+        });
+        auto& priorityBatch = ctx.m_priorityBatch;
+        priorityBatch.clear();
+        while(size_t priorityCount = priorityQueue->tryDequeueBulk(priorityBatch, m_batchSize))
+        {
+            countDequeued(ctx.m_index, priorityCount);
+            if(!hasMarker || priorityCount < m_batchSize)
+            {
+                break;
+            }
+        }
+        if(!priorityBatch.empty())
+        {
+            batch.insert(batch.begin(), std::make_move_iterator(priorityBatch.begin()),
+                std::make_move_iterator(priorityBatch.end()));
+        }
+    }
+
+    if(batch.empty())
+    {
+        leaveEpoch(ctx.m_index);
+    }
+    return batch.size();
+}
+
+void ThreadPool::leaveEpoch(size_t workerIndex)
+{
+    m_workerEpochs[workerIndex].m_value.fetch_add(1, std::memory_order_seq_cst);
+    if(m_epochWaiters.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_epochMutex);
+        m_epochCond.notify_all();
+    }
+    // 回到偶数纪元之后再检查:在此之前登记、等待本线程的刷新请求一定能在这里或登记方自己的检查中完成
+    completePendingFlushes();
+}
+
+size_t ThreadPool::waitForBatch(WorkerContext& ctx)
+{
+    auto& queue = *ctx.m_shard->m_queue;
+    // 窃取到分组说明其他分片仍然繁忙,重新开始计数,不急于挂起
+    // 窃取期间处于偶数纪元:领走的分组属于其他分片,由那个分片的线程保持奇数纪元直到分组写完
+    for(uint32_t i = 0; i < m_waitStrategy.spinCount; ++i)
+    {
+        if(size_t count = takeBatch(ctx, true))
+        {
+            return count;
+        }
+        if(m_workStealing && stealWork(ctx))
+        {
+            i = 0;
+            continue;
+        }
+        cpuRelax();
+    }
+
+    for(uint32_t i = 0; i < m_waitStrategy.yieldCount; ++i)
+    {
+        if(size_t count = takeBatch(ctx, true))
+        {
+            return count;
+        }
+        if(m_workStealing && stealWork(ctx))
+        {
+            i = 0;
+            continue;
+        }
+        std::this_thread::yield();
+    }
+
+    while(m_workStealing && stealWork(ctx))
+    {
+        if(size_t count = takeBatch(ctx, true))
+        {
+            return count;
+        }
+    }
+
+    // 挂起期间处于偶数纪元,barrier/Flush 不必等待挂起的线程;有数据(或超时)之后再进入奇数纪元取出
+    queue.waitForData(m_waitStrategy.parkTimeout);
+    return takeBatch(ctx, true);
+}
+
+void ThreadPool::handleFlush(WorkerContext& ctx, AsyncMsg& msg)
+{
+    // 本线程在 Flush 之前取出的消息已经写完;检查同一分片的其他线程是否还在处理更早取出的批次
+    std::vector<uint64_t> epochs;
+    if(ctx.m_shard->m_workerIndices.size() > 1)
+    {
+        epochs.assign(m_workers.size(), 0);
+        bool waiting = false;
+        for(size_t i : ctx.m_shard->m_workerIndices)
+        {
+            uint64_t current = m_workerEpochs[i].m_value.load(std::memory_order_seq_cst);
+            if(i != ctx.m_index && current % 2 == 1)
+            {
+                epochs[i] = current;
+                waiting = true;
+            }
+        }
+        if(!waiting)
+        {
+            epochs.clear();
+        }
+    }
+
+    if(epochs.empty())
+    {
+        if(msg.m_workerPtr)
+        {
+            msg.m_workerPtr->backendSinkFlush();
+        }
+        msg.m_completion.complete();
+        return;
+    }
+
+    PendingFlush pending;
+    if(msg.m_workerPtr)
+    {
+        pending.m_sinks = msg.m_workerPtr->m_sinks;
+    }
+    pending.m_completion = std::move(msg.m_completion);
+    pending.m_epochs = std::move(epochs);
+
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_pendingFlushes.push_back(std::move(pending));
+    // 与 leaveEpoch 配对:登记之后本线程在批次末尾还会检查一次,工作线程回到偶数纪元之后也会检查
+    m_pendingFlushCount.store(m_pendingFlushes.size(), std::memory_order_seq_cst);
+}
+
+void ThreadPool::completePendingFlushes()
+{
+    if(m_pendingFlushCount.load(std::memory_order_seq_cst) == 0)
+    {
+        return;
+    }
+
+    std::vector<PendingFlush> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        auto it = m_pendingFlushes.begin();
+        while(it != m_pendingFlushes.end())
+        {
+            // 纪元变化说明那个线程结束了登记时正在处理的那一批
+            bool done = true;
+            for(size_t i = 0; i < it->m_epochs.size() && done; ++i)
+            {
+                uint64_t snapshot = it->m_epochs[i];
+                done = snapshot == 0
+                    || m_workerEpochs[i].m_value.load(std::memory_order_seq_cst) != snapshot;
+            }
+            if(done)
+            {
+                ready.push_back(std::move(*it));
+                it = m_pendingFlushes.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        m_pendingFlushCount.store(m_pendingFlushes.size(), std::memory_order_release);
+    }
+
+    for(auto& pending : ready)
+    {
+        for(auto& sink : pending.m_sinks)
+        {
+            sink->flush();
+        }
+        pending.m_completion.complete();
+    }
+}
+
+void ThreadPool::formatDeferred(WorkerContext& ctx)
+{
+    auto& batch = ctx.m_batch;
+    auto& text = ctx.m_deferredText;
+    auto& ranges = ctx.m_deferredRanges;
+    text.clear();
+    ranges.clear();
+
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        if(batch[i].m_formatArgs != nullptr)
+        {
+            ranges.emplace_back(i, text.size());
+            batch[i].m_formatArgs(batch[i].m_payload, text);
+        }
+    }
+
+    // 文本缓冲区在追加过程中可能重新分配,全部格式化完之后再设置 m_payload
+    // 这些消息不会再被移动,随 m_batch.clear() 一起销毁
+    for(size_t r = 0; r < ranges.size(); ++r)
+    {
+        size_t end = r + 1 < ranges.size() ? ranges[r + 1].second : text.size();
+        AsyncMsg& msg = batch[ranges[r].first];
+        msg.m_payload = StringView(text.data() + ranges[r].second, end - ranges[r].second);
+        msg.m_formatArgs = nullptr;
+    }
+}
+
+void ThreadPool::dispatchLogMsgs(WorkerContext& ctx, size_t first, size_t last)
+{
+    size_t groupCount = buildGroups(ctx, first, last);
+    auto& groups = ctx.m_groups;
+    if((m_workStealing || m_fairQuantum > 0) && groupCount > 1)
+    {
+        // 两者不能同时开启(构造函数检查)
+        if(m_workStealing)
+        {
+            dispatchGroupsShared(ctx, groupCount);
+        }
+        else
+        {
+            dispatchGroupsFair(ctx, groupCount);
+        }
+        return;
+    }
+
+    for(size_t g = 0; g < groupCount; ++g)
+    {
+        // 调用 AsyncLogger 的 backendSinkLogBatch
+        groups[g].first->backendSinkLogBatch(groups[g].second);
+    }
+}
+
+size_t ThreadPool::buildGroups(WorkerContext& ctx, size_t first, size_t last)
+{
+    auto& batch = ctx.m_batch;
+    auto& slots = ctx.m_slots;
+    auto& groups = ctx.m_groups;
+    slots.clear();
+
+    // 一批里的 logger 通常很少,线性查找即可;连续来自同一 logger 时直接复用上一次的查找结果
+    size_t groupCount = 0;
+    size_t current = NO_GROUP;
+    for(size_t i = first; i < last; ++i)
+    {
+        AsyncLogger* logger = batch[i].m_workerPtr;
+        if(logger == nullptr)
+        {
+            continue;
+        }
+        if(current == NO_GROUP || slots[current].m_logger != logger)
+        {
+            current = 0;
+            while(current < slots.size() && slots[current].m_logger != logger)
+            {
+                ++current;
+            }
+            if(current == slots.size())
+            {
+                slots.push_back(LoggerSlot{logger, NO_GROUP});
+            }
+        }
+
+        if(slots[current].m_openGroup == NO_GROUP)
+        {
+            // 新分组排在所有已有分组之后;与它共用 sink 的 logger 再有消息时不能再追加到更早的分组
+            for(size_t k = 0; k < slots.size(); ++k)
+            {
+                if(k != current && slots[k].m_openGroup != NO_GROUP && sharesSink(*slots[k].m_logger, *logger))
+                {
+                    slots[k].m_openGroup = NO_GROUP;
+                }
+            }
+            if(groups.size() == groupCount)
+            {
+                groups.emplace_back();
+            }
+            groups[groupCount].first = logger;
+            groups[groupCount].second.clear();
+            slots[current].m_openGroup = groupCount++;
+        }
+        groups[slots[current].m_openGroup].second.push_back(&batch[i]);
+    }
+    return groupCount;
+}
+
+bool ThreadPool::sharesSink(const AsyncLogger& a, const AsyncLogger& b)
+{
+    for(auto& sink : a.m_sinks)
+    {
+        if(std::find(b.m_sinks.begin(), b.m_sinks.end(), sink) != b.m_sinks.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::dispatchGroupsFair(WorkerContext& ctx, size_t groupCount)
+{
+    auto& groups = ctx.m_groups;
+    auto& pos = ctx.m_groupPos;
+    auto& deficits = ctx.m_deficits;
+    auto& blockers = ctx.m_blockers;
+    pos.assign(groupCount, 0);
+    deficits.assign(groupCount, 0);
+
+    // 与更早的分组共用 sink 的分组要等那些分组写完才能开始,否则同一 sink 上的消息会重排
+    blockers.assign(groupCount, 0);
+    for(size_t g = 1; g < groupCount; ++g)
+    {
+        for(size_t h = 0; h < g; ++h)
+        {
+            if(sharesSink(*groups[h].first, *groups[g].first))
+            {
+                ++blockers[g];
+            }
+        }
+    }
+
+    size_t remaining = groupCount;
+    while(remaining > 0)
+    {
+        for(size_t g = 0; g < groupCount; ++g)
+        {
+            const LogMsgBatch& msgs = groups[g].second;
+            if(pos[g] == msgs.size() || blockers[g] > 0)
+            {
+                continue;
+            }
+
+            // 本轮额度内的消息整段交给 sink;超过额度的长消息攒够额度后在之后的轮次写出
+            deficits[g] += m_fairQuantum;
+            ctx.m_logMsgs.clear();
+            while(pos[g] < msgs.size() && msgs[pos[g]]->m_payload.size() <= deficits[g])
+            {
+                deficits[g] -= msgs[pos[g]]->m_payload.size();
+                ctx.m_logMsgs.push_back(msgs[pos[g]]);
+                ++pos[g];
+            }
+            if(!ctx.m_logMsgs.empty())
+            {
+                groups[g].first->backendSinkLogBatch(ctx.m_logMsgs);
+            }
+            if(pos[g] == msgs.size())
+            {
+                deficits[g] = 0;
+                --remaining;
+                for(size_t k = g + 1; k < groupCount; ++k)
+                {
+                    if(blockers[k] > 0 && sharesSink(*groups[g].first, *groups[k].first))
+                    {
+                        --blockers[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+size_t ThreadPool::buildUnits(WorkerContext& ctx, size_t groupCount)
+{
+    auto& slots = ctx.m_slots;
+    auto& groups = ctx.m_groups;
+    auto& parent = ctx.m_unitParent;
+
+    // 并查集:共用 sink 的 logger 合并到同一单元
+    auto find = [&parent](size_t x) {
+        while(parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    parent.resize(slots.size());
+    for(size_t j = 0; j < slots.size(); ++j)
+    {
+        parent[j] = j;
+        for(size_t k = 0; k < j; ++k)
+        {
+            if(sharesSink(*slots[k].m_logger, *slots[j].m_logger))
+            {
+                parent[find(j)] = find(k);
+            }
+        }
+    }
+
+    // 单元编号按首次出现的顺序分配,之后按单元计数排序,单元内保持分组原有的先后顺序
+    auto& unitOf = ctx.m_unitOf;
+    auto& begin = ctx.m_unitBegin;
+    unitOf.assign(slots.size(), NO_GROUP);
+    begin.assign(1, 0);
+    ctx.m_groupUnits.resize(groupCount);
+    for(size_t g = 0; g < groupCount; ++g)
+    {
+        size_t slot = 0;
+        while(slots[slot].m_logger != groups[g].first)
+        {
+            ++slot;
+        }
+        size_t root = find(slot);
+        if(unitOf[root] == NO_GROUP)
+        {
+            unitOf[root] = begin.size() - 1;
+            begin.push_back(0);
+        }
+        ctx.m_groupUnits[g] = unitOf[root];
+        ++begin[unitOf[root] + 1];
+    }
+    size_t unitCount = begin.size() - 1;
+    if(unitCount == 1)
+    {
+        return 1;
+    }
+
+    for(size_t u = 0; u < unitCount; ++u)
+    {
+        begin[u + 1] += begin[u];
+    }
+    auto& next = ctx.m_unitFill;
+    next.assign(begin.begin(), begin.end() - 1);
+    ctx.m_unitGroups.resize(groupCount);
+    for(size_t g = 0; g < groupCount; ++g)
+    {
+        ctx.m_unitGroups[next[ctx.m_groupUnits[g]]++] = g;
+    }
+    return unitCount;
+}
+
+void ThreadPool::writeUnit(WorkerContext& ctx, size_t unit)
+{
+    for(size_t i = ctx.m_unitBegin[unit]; i < ctx.m_unitBegin[unit + 1]; ++i)
+    {
+        auto& group = ctx.m_groups[ctx.m_unitGroups[i]];
+        group.first->backendSinkLogBatch(group.second);
+    }
+}
+
+void ThreadPool::dispatchGroupsShared(WorkerContext& ctx, size_t groupCount)
+{
+    size_t unitCount = buildUnits(ctx, groupCount);
+    if(unitCount == 1)
+    {
+        // 所有 logger 通过 sink 连成一片,只能由本线程按顺序写出
+        for(size_t g = 0; g < groupCount; ++g)
+        {
+            ctx.m_groups[g].first->backendSinkLogBatch(ctx.m_groups[g].second);
+        }
+        return;
+    }
+
+    Shard& shard = *ctx.m_shard;
+    {
+        std::lock_guard<std::mutex> lock(shard.m_stealMutex);
+        shard.m_stealCtx = &ctx;
+        shard.m_stealNext = 1;
+        shard.m_stealCount = unitCount;
+        shard.m_stealDone.store(0, std::memory_order_relaxed);
+        shard.m_stealable.store(true, std::memory_order_release);
+    }
+
+    // 第 0 个单元由本线程直接写出,其余单元和空闲线程抢着领
+    writeUnit(ctx, 0);
+    while(true)
+    {
+        size_t unit;
+        {
+            std::lock_guard<std::mutex> lock(shard.m_stealMutex);
+            if(shard.m_stealNext >= shard.m_stealCount)
+            {
+                break;
+            }
+            unit = shard.m_stealNext++;
+            if(shard.m_stealNext == shard.m_stealCount)
+            {
+                shard.m_stealable.store(false, std::memory_order_relaxed);
+            }
+        }
+        writeUnit(ctx, unit);
+        shard.m_stealDone.fetch_add(1, std::memory_order_release);
+    }
+
+    // 等被领走的单元写完:之后的消息(包括同一 sink 的下一段)才能继续处理,批次缓冲区才能复用
+    while(shard.m_stealDone.load(std::memory_order_acquire) < unitCount - 1)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool ThreadPool::stealWork(WorkerContext& ctx)
+{
+    size_t shardCount = m_shards.size();
+    for(size_t offset = 1; offset < shardCount; ++offset)
+    {
+        Shard& shard = *m_shards[(ctx.m_index + offset) % shardCount];
+        if(!shard.m_stealable.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        WorkerContext* owner = nullptr;
+        size_t unit = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard.m_stealMutex);
+            if(shard.m_stealNext < shard.m_stealCount)
+            {
+                owner = shard.m_stealCtx;
+                unit = shard.m_stealNext++;
+                if(shard.m_stealNext == shard.m_stealCount)
+                {
+                    shard.m_stealable.store(false, std::memory_order_relaxed);
+                }
+            }
+        }
+        if(owner == nullptr)
+        {
+            continue;
+        }
+
+        // 单元所在分片的线程会等到 m_stealDone 计满才继续,期间它的分组与消息保持有效
+        writeUnit(*owner, unit);
+        shard.m_stealDone.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+    return false;
 }
 
 
 }// namespace details
-}// namespace minispdlog
\ No newline at end of file
+}// namespace minispdlog
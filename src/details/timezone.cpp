@@ -0,0 +1,72 @@
+#include "minispdlog/details/timezone.h"
+
+namespace minispdlog {
+namespace details {
+
+namespace {
+
+// 探测窗口:向前、向后各一天
+constexpr int64_t PROBE_WINDOW = 86400;
+
+int32_t localOffset(int64_t secs)
+{
+    std::time_t timeT = static_cast<std::time_t>(secs);
+    std::tm tmVal;
+    localtime_r(&timeT, &tmVal);
+    return static_cast<int32_t>(tmVal.tm_gmtoff);
+}
+
+}
+
+void UtcOffsetCache::refresh(int64_t secs)
+{
+    int32_t offset = localOffset(secs);
+
+    // 向后:若一天后偏移不同,二分出第一个偏移改变的时刻
+    int64_t lo = secs;
+    int64_t hi = secs + PROBE_WINDOW;
+    if (localOffset(hi) != offset)
+    {
+        while (hi - lo > 1)
+        {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (localOffset(mid) == offset)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+    }
+    m_validUntil = hi;
+
+    // 向前:异步线程池中消息可能乱序到达,区间也向前延伸,避免来回刷新
+    lo = secs - PROBE_WINDOW;
+    hi = secs;
+    if (localOffset(lo) != offset)
+    {
+        while (hi - lo > 1)
+        {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (localOffset(mid) == offset)
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid;
+            }
+        }
+    }
+    else
+    {
+        hi = lo;
+    }
+    m_validFrom = hi;
+    m_offset = offset;
+}
+
+}
+}
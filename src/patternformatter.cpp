@@ -1,368 +1,141 @@
 #include "minispdlog/patternformatter.h"
 #include "minispdlog/details/utils.h"
+#include "minispdlog/details/patternflags.h"
 #include <iomanip>
 #include <sstream>
 #include <cctype>
+#include <algorithm>
 
 namespace minispdlog
 {
 
-    // 快速整数到字符串转换
-inline void fast_uint_to_str(uint64_t n, char* buffer) {
-    // 使用查表法优化小数字
-    static constexpr char digits_table[] = 
-        "0001020304050607080910111213141516171819"
-        "2021222324252627282930313233343536373839"
-        "4041424344454647484950515253545556575859"
-        "6061626364656667686970717273747576777879"
-        "8081828384858687888990919293949596979899";
-    
-    if (n < 100) {
-        if (n < 10) {
-            buffer[0] = '0' + n;
-            buffer[1] = '\0';
-        } else {
-            const char* d = digits_table + n * 2;
-            buffer[0] = d[0];
-            buffer[1] = d[1];
-            buffer[2] = '\0';
-        }
-        return;
-    }
-    
-    // 对于大数字，回退到标准方法
-    fmt::format_to(buffer, "{}", n);
-}
-
-// 快速两位数转换(用于时间格式化)
-inline void fast_two_digits(uint32_t n, char* buffer) {
-    if (n < 100) {
-        const char* d = "0001020304050607080910111213141516171819"
-                       "2021222324252627282930313233343536373839"
-                       "4041424344454647484950515253545556575859"
-                       "6061626364656667686970717273747576777879"
-                       "8081828384858687888990919293949596979899" + n * 2;
-        buffer[0] = d[0];
-        buffer[1] = d[1];
-    } else {
-        buffer[0] = '0';
-        buffer[1] = '0';
-    }
-}
-
-//普通文本
-class RawStringFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    explicit RawStringFormatter(const std::string& str)
-        : m_str(str)
-    {}
-
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(m_str.data(), m_str.data() + m_str.size());
-    }
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<RawStringFormatter>(m_str);
-    }
-
-private:
-    std::string m_str;
-};
-
-class AggregateFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    explicit AggregateFormatter(std::string str)
-        : m_str(std::move(str))
-    {}
-
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(m_str.data(), m_str.data() + m_str.size());
-    }
-    
-    void addCh(char ch){ m_str += ch; }
-    void addStr(const std::string& str){ m_str += str; }
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<AggregateFormatter>(m_str);
-    }
-
-private:
-    std::string m_str;
-};
-
-//%Y : 年份
-class YearFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[5];
-        int year = time.tm_year + 1900;
-        // 手动展开避免 sprintf 开销
-        buffer[0] = '0' + (year / 1000);
-        buffer[1] = '0' + ((year / 100) % 10);
-        buffer[2] = '0' + ((year / 10) % 10);
-        buffer[3] = '0' + (year % 10);
-        buffer[4] = '\0';
-        dest.append(buffer, buffer + 4);
-    }
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<YearFormatter>();
-    }
-};
-
-//%m : 月份
-class MonthFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[3];
-        fast_two_digits(time.tm_mon + 1, buffer);
-        dest.append(buffer, buffer + 2);
-    }
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<MonthFormatter>();
-    }
-};
-
-//%d : 日期
-class DayFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[3];
-        fast_two_digits(time.tm_mday, buffer);
-        dest.append(buffer, buffer + 2);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<DayFormatter>();
-    }
-
-};
-
-//H : 小时
-class HourFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[3];
-        fast_two_digits(time.tm_hour, buffer);
-        dest.append(buffer, buffer + 2);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<HourFormatter>();
-    }
-};
-
-//%M : 分钟
-class MinuteFormatter : public PatternFormatter::FlagFormatter
+struct PatternFormatter::Compiler
 {
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[3];
-        fast_two_digits(time.tm_min, buffer);
-        dest.append(buffer, buffer + 2);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<MinuteFormatter>();
-    }
-};
-
-//%S : 秒
-class SecondFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[3];
-        fast_two_digits(time.tm_sec, buffer);
-        dest.append(buffer, buffer + 2);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<SecondFormatter>();
-    }
-};
-
-//%t : 线程ID
-class ThreadIdFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        char buffer[64];
-        fast_uint_to_str(static_cast<uint64_t>(msg.m_threadId), buffer);
-        size_t len = std::strlen(buffer);
-        dest.append(buffer, buffer + len);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<ThreadIdFormatter>();
-    }
-};
-
-//%l : 日志级别(短格式 I W E C T D)
-class LevelShortFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        static constexpr std::string_view levelStrings[] = {
-            "T", "D", "I", "W", "E", "C"  // 编译时预计算
-        };
-        
-        auto levelStr = levelStrings[static_cast<size_t>(msg.m_level)];
-        dest.append(levelStr.data(), levelStr.data() + levelStr.size());
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<LevelShortFormatter>();
-    }
-};
-
-//%L : 日志级别(完整格式 INFO WARN ERROR CRITICAL TRACE DEBUG)
-class LevelFullFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        static constexpr std::string_view level_strings[] = {
-            "trace", "debug", "info", "warning", "error", "critical"
-        };
-
-        auto level_str = level_strings[static_cast<size_t>(msg.m_level)];
-        dest.append(level_str.data(), level_str.data() + level_str.size());
-
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<LevelFullFormatter>();
-    }
-};
-
-//%n : logger名称
-class LoggerNameFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(msg.m_loggerName.data(), msg.m_loggerName.data() + msg.m_loggerName.size());
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<LoggerNameFormatter>();
+    PatternFormatter& m_owner;
+    bool m_inText{false};
+
+    void text(char ch)
+    {
+        // 相邻的普通文本合并为一条指令
+        if (!m_inText)
+        {
+            Instruction ins;
+            ins.m_offset = static_cast<uint32_t>(m_owner.m_text.size());
+            m_owner.m_code.push_back(ins);
+            m_inText = true;
+        }
+        m_owner.m_text.push_back(ch);
+        ++m_owner.m_code.back().m_size;
     }
-};
-
-//%v : 日志消息内容
-class PayloadFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(msg.m_payload.data(), msg.m_payload.data() + msg.m_payload.size());
-    }   
 
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
+    void flag(char flag, details::flags::PadSpec pad)
     {
-        return std::make_unique<PayloadFormatter>();
+        Instruction ins;
+        ins.m_op = flag;
+        ins.m_pad = pad;
+        m_owner.m_code.push_back(ins);
+        m_owner.m_needsTime = m_owner.m_needsTime || details::flags::needsTime(flag);
+        m_owner.m_needsElapsed = m_owner.m_needsElapsed || details::flags::isElapsed(flag);
+        m_inText = false;
     }
 };
 
-//%F : 源码文件名
-class SourceFileFormatter : public PatternFormatter::FlagFormatter
-{
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(msg.m_sourceLocation.m_fileName,
-                    msg.m_sourceLocation.m_fileName + std::strlen(msg.m_sourceLocation.m_fileName));
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<SourceFileFormatter>();
-    }
-};
-
-//%f : 源码所在函数
-class SourceFunctionFormatter : public PatternFormatter::FlagFormatter
+//PatternFormatter 方法实现
+PatternFormatter::PatternFormatter(std::string pattern, PatternTimeType timeType)
+    : m_pattern(std::move(pattern))
+    , m_timeType(timeType)
 {
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
-    {
-        dest.append(msg.m_sourceLocation.m_functionName,
-                    msg.m_sourceLocation.m_functionName + std::strlen(msg.m_sourceLocation.m_functionName));
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<SourceFunctionFormatter>();
-    }
-};
+    compilePattern();
+}
 
-//%P : 源码行号
-class SourceLineFormatter : public PatternFormatter::FlagFormatter
+inline void PatternFormatter::execute(const Instruction& ins, const details::LogMsg& msg, fmt::memory_buffer& dest) const
 {
-public:
-    void format(const details::LogMsg& msg, const std::tm& time, fmt::memory_buffer& dest) override
+    switch (ins.m_op)
     {
-        fmt::format_to(std::back_inserter(dest), "{}", msg.m_sourceLocation.m_line);
-    }   
-
-    std::unique_ptr<PatternFormatter::FlagFormatter> clone() const override
-    {
-        return std::make_unique<SourceLineFormatter>();
+        case OP_TEXT:
+        {
+            const char* text = m_text.data() + ins.m_offset;
+            dest.append(text, text + ins.m_size);
+            break;
+        }
+        case OP_TIME_RUN:
+        {
+            const TimeRun& run = m_timeRuns[ins.m_offset];
+            const char* cached = m_timeCache.data() + run.m_cacheOffset;
+            size_t start = dest.size();
+            dest.append(cached, cached + run.m_cacheSize);
+            if (run.m_patchBegin != run.m_patchEnd)
+            {
+                uint32_t nanos = details::flags::subsecondNanos(msg);
+                char* base = dest.data() + start;
+                for (uint32_t i = run.m_patchBegin; i < run.m_patchEnd; ++i)
+                {
+                    details::flags::writeSubsecond(m_timePatches[i].m_flag, nanos, base + m_timePatches[i].m_offset);
+                }
+            }
+            break;
+        }
+        case 'Y': details::flags::year(m_cachedTm, dest); break;
+        case 'm': details::flags::month(m_cachedTm, dest); break;
+        case 'd': details::flags::day(m_cachedTm, dest); break;
+        case 'H': details::flags::hour(m_cachedTm, dest); break;
+        case 'M': details::flags::minute(m_cachedTm, dest); break;
+        case 'S': details::flags::second(m_cachedTm, dest); break;
+        case 'z': details::flags::utcOffset(m_utcOffset, dest); break;
+        case 't': details::flags::threadId(msg, dest); break;
+        case 'l': details::flags::levelShort(msg, dest); break;
+        case 'L': details::flags::levelFull(msg, dest); break;
+        case 'n': details::flags::loggerName(msg, dest); break;
+        case 'v': details::flags::payload(msg, dest); break;
+        case 'N': details::flags::sequence(msg, dest); break;
+        case 'e':
+        case 'f':
+        case 'F': details::flags::subsecond(ins.m_op, msg, dest); break;
+        case 'o':
+        case 'i':
+        case 'u':
+        case 'O': details::flags::elapsed(ins.m_op, m_elapsedNs, dest); break;
+        default: break;
     }
-};
-
-
-//PatternFormatter 方法实现
-PatternFormatter::PatternFormatter(std::string pattern)
-    : m_pattern(std::move(pattern))
-{
-    compilePattern();
 }
 
 void PatternFormatter::format(const details::LogMsg& msg, fmt::memory_buffer& dest)
 {
     dest.reserve(dest.size() + 256); // 预留空间，避免多次内存分配
 
-    auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.m_timePoint.time_since_epoch());
-    if (secs != m_lastTimeSec)
+    if (m_needsTime)
+    {
+        auto secs = std::chrono::floor<std::chrono::seconds>(msg.m_timePoint.time_since_epoch()); // 与秒以下占位符一致,1970 年之前也向下取整
+        if (secs != m_lastTimeSec)
+        {
+            details::toCalendar(secs.count(), m_timeType, m_offsetCache, m_cachedTm, m_utcOffset);
+            m_lastTimeSec = secs;
+            renderTimeRuns(msg);
+        }
+    }
+
+    if (m_needsElapsed)
     {
-        m_cachedTm = getTime(msg);
-        m_lastTimeSec = secs;
+        // 时间倒退(多个工作线程乱序写出)时记为 0
+        int64_t elapsedNs = m_hasLastMsg ?
+            std::chrono::duration_cast<std::chrono::nanoseconds>(msg.m_timePoint - m_lastMsgTime).count() : 0;
+        m_elapsedNs = std::max<int64_t>(elapsedNs, 0);
+        m_lastMsgTime = msg.m_timePoint;
+        m_hasLastMsg = true;
     }
 
-    for(auto& formatter : m_formatters)
+    for (const Instruction& ins : m_code)
     {
-        formatter->format(msg, m_cachedTm, dest);
+        if (ins.m_pad.m_width == 0)
+        {
+            execute(ins, msg, dest);
+        }
+        else
+        {
+            size_t start = dest.size();
+            execute(ins, msg, dest);
+            details::flags::applyPadding(dest, start, ins.m_pad);
+        }
     }
 
     dest.push_back('\n');
@@ -370,82 +143,119 @@ void PatternFormatter::format(const details::LogMsg& msg, fmt::memory_buffer& de
 
 std::unique_ptr<Formatter> PatternFormatter::clone() const
 {
-    return std::make_unique<PatternFormatter>(m_pattern);
+    // 指令是平凡类型,拷贝即内存复制;时间缓存一并带过去
+    return std::make_unique<PatternFormatter>(*this);
 }
 
 void PatternFormatter::setPattern(const std::string& pattern)
 {
     m_pattern = pattern;
-    m_formatters.clear();
     compilePattern();
 }
 
 void PatternFormatter::compilePattern()
 {
-    auto it = m_pattern.begin();
-    auto end = m_pattern.end();
-    std::unique_ptr<AggregateFormatter> userChars;
-    
-    while (it != end) {
-        if (*it == '%') {
-            // 保存聚合的普通文本
-            if (userChars) {
-                m_formatters.push_back(std::move(userChars));
-            }
-            
-            // 解析占位符
-            ++it;
-            if (it != end) {
-                char flag = *it;
-                ++it;
-                
-                // 根据 flag 创建对应的 formatter
-                switch (flag) {
-                    case 'Y': m_formatters.push_back(std::make_unique<YearFormatter>()); break;
-                    case 'm': m_formatters.push_back(std::make_unique<MonthFormatter>()); break;
-                    case 'd': m_formatters.push_back(std::make_unique<DayFormatter>()); break;
-                    case 'H': m_formatters.push_back(std::make_unique<HourFormatter>()); break;
-                    case 'M': m_formatters.push_back(std::make_unique<MinuteFormatter>()); break;
-                    case 'S': m_formatters.push_back(std::make_unique<SecondFormatter>()); break;
-                    case 'l': m_formatters.push_back(std::make_unique<LevelShortFormatter>()); break;
-                    case 'L': m_formatters.push_back(std::make_unique<LevelFullFormatter>()); break;
-                    case 'n': m_formatters.push_back(std::make_unique<LoggerNameFormatter>()); break;
-                    case 'v': m_formatters.push_back(std::make_unique<PayloadFormatter>()); break;
-                    case 't': m_formatters.push_back(std::make_unique<ThreadIdFormatter>()); break;
-                    case '%': 
-                        if (!userChars) userChars = std::make_unique<AggregateFormatter>("");
-                        userChars->addCh('%'); 
-                        break;
-                    default:
-                        // 未知占位符,创建聚合formatter
-                        if (!userChars) userChars = std::make_unique<AggregateFormatter>("");
-                        userChars->addCh('%');
-                        userChars->addCh(flag);
-                        break;
-                }
-            }
-        } else {
-            // 普通字符,累积到聚合formatter
-            if (!userChars) {
-                userChars = std::make_unique<AggregateFormatter>("");
+    m_code.clear();
+    m_text.clear();
+    m_timeCode.clear();
+    m_timeRuns.clear();
+    m_timePatches.clear();
+    m_timeCache.clear();
+    m_lastTimeSec = std::chrono::seconds::min();
+    m_needsTime = false;
+    m_needsElapsed = false;
+    m_hasLastMsg = false;
+
+    Compiler compiler{*this};
+    details::flags::parsePattern(m_pattern.data(), m_pattern.data() + m_pattern.size(), compiler);
+    groupTimeRuns();
+
+    m_code.shrink_to_fit();
+    m_text.shrink_to_fit();
+}
+
+void PatternFormatter::groupTimeRuns()
+{
+    std::vector<Instruction> code;
+    size_t i = 0;
+    while (i < m_code.size())
+    {
+        // 从 i 开始最长的一段普通文本/时间占位符,其中至少要有一个按秒变化的时间占位符
+        // 不带宽度说明的 %e/%f/%F 宽度固定,也可以留在段内,逐条消息写入
+        size_t end = i;
+        bool hasTime = false;
+        while (end < m_code.size() && inTimeRun(m_code[end]))
+        {
+            hasTime = hasTime || details::flags::needsTime(m_code[end].m_op);
+            ++end;
+        }
+        if (!hasTime)
+        {
+            end = std::max(end, i + 1);
+            code.insert(code.end(), m_code.begin() + i, m_code.begin() + end);
+            i = end;
+            continue;
+        }
+
+        TimeRun run;
+        run.m_codeBegin = static_cast<uint32_t>(m_timeCode.size());
+        run.m_patchBegin = static_cast<uint32_t>(m_timePatches.size());
+        for (size_t k = i; k < end; ++k)
+        {
+            m_timeCode.push_back(m_code[k]);
+            if (details::flags::isSubsecond(m_code[k].m_op))
+            {
+                TimePatch patch;
+                patch.m_flag = m_code[k].m_op;
+                m_timePatches.push_back(patch); // 位置在渲染时确定
             }
-            userChars->addCh(*it);
-            ++it;
         }
+        run.m_codeEnd = static_cast<uint32_t>(m_timeCode.size());
+        run.m_patchEnd = static_cast<uint32_t>(m_timePatches.size());
+
+        Instruction ins;
+        ins.m_op = OP_TIME_RUN;
+        ins.m_offset = static_cast<uint32_t>(m_timeRuns.size());
+        m_timeRuns.push_back(run);
+        code.push_back(ins);
+        i = end;
     }
-    
-    // 处理末尾的聚合文本
-    if (userChars) {
-        m_formatters.push_back(std::move(userChars));
-    }
+    m_code.swap(code);
+}
+
+bool PatternFormatter::inTimeRun(const Instruction& ins)
+{
+    return ins.m_op == OP_TEXT || details::flags::needsTime(ins.m_op) ||
+        (details::flags::isSubsecond(ins.m_op) && ins.m_pad.m_width == 0);
 }
 
-std::tm PatternFormatter::getTime(const details::LogMsg& msg)
+void PatternFormatter::renderTimeRuns(const details::LogMsg& msg)
 {
-    auto timeT = LogClock::to_time_t(msg.m_timePoint);
-    std::tm tmVal;
-    localtime_r(&timeT, &tmVal);
-    return tmVal;
+    fmt::memory_buffer buf;
+    for (TimeRun& run : m_timeRuns)
+    {
+        run.m_cacheOffset = static_cast<uint32_t>(buf.size());
+        uint32_t patch = run.m_patchBegin;
+        for (uint32_t i = run.m_codeBegin; i < run.m_codeEnd; ++i)
+        {
+            const Instruction& ins = m_timeCode[i];
+            if (details::flags::isSubsecond(ins.m_op))
+            {
+                static constexpr char ZEROS[] = "000000000";
+                m_timePatches[patch++].m_offset = static_cast<uint32_t>(buf.size() - run.m_cacheOffset);
+                buf.append(ZEROS, ZEROS + details::flags::subsecondWidth(ins.m_op));
+                continue;
+            }
+            size_t start = buf.size();
+            execute(ins, msg, buf);
+            if (ins.m_pad.m_width != 0)
+            {
+                details::flags::applyPadding(buf, start, ins.m_pad);
+            }
+        }
+        run.m_cacheSize = static_cast<uint32_t>(buf.size() - run.m_cacheOffset);
+    }
+    m_timeCache.assign(buf.data(), buf.size());
 }
 
 }//minispdlog
\ No newline at end of file
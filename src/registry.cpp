@@ -1,6 +1,9 @@
 #include "minispdlog/registry.h"
+#include "minispdlog/asynclogger.h"
 #include "minispdlog/sinks/colorconsolesink.h"
 #include <stdexcept>
+#include <vector>
+#include <future>
 
 namespace minispdlog
 {
@@ -79,15 +82,101 @@ void Registry::setLevel(level lvl)
 
 void Registry::flushAll()
 {
+    // 刷新可能很慢(同步 sink 写盘,异步 logger 队列已满),不在持有 m_mutex 时进行
+    for(auto& logger : snapshotLoggers())
+    {
+        logger->flush();
+    }
+}
+
+bool Registry::flushAllFor(std::chrono::milliseconds timeout)
+{
+    // 投递可能因队列已满而阻塞,不在持有 m_mutex 时进行
+    std::vector<std::future<void>> futures;
+    for(auto& logger : snapshotLoggers())
+    {
+        if(auto asyncLogger = std::dynamic_pointer_cast<AsyncLogger>(logger))
+        {
+            futures.push_back(asyncLogger->flushAsync());
+        }
+        else
+        {
+            logger->flush();
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool allDone = true;
+    for(auto& future : futures)
+    {
+        if(future.wait_until(deadline) != std::future_status::ready)
+        {
+            allDone = false;
+            continue;
+        }
+        try
+        {
+            future.get();
+        }
+        catch(const std::runtime_error&)
+        {
+            allDone = false;
+        }
+    }
+    return allDone;
+}
+
+void Registry::flushEvery(std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(m_flusherMutex);
+    m_periodicFlusher.reset(); // 先停掉原来的线程,同一时刻只有一个刷新线程
+    if(interval.count() > 0)
+    {
+        m_periodicFlusher = std::make_unique<details::PeriodicWorker>([this]() { flushPeriodic(); }, interval);
+    }
+}
+
+void Registry::flushPeriodic()
+{
+    for(auto& logger : snapshotLoggers())
+    {
+        // AsyncLogger::flush 只投递刷新请求,由工作线程和日志一起串行写入,不等待完成
+        if(std::dynamic_pointer_cast<AsyncLogger>(logger))
+        {
+            logger->flush();
+            continue;
+        }
+        // 同步 logger 的 sink 由写日志的线程直接调用,_st sink 不能在这里并发刷新
+        bool threadSafe = true;
+        for(auto& sink : logger->sinks())
+        {
+            if(!sink->threadSafe())
+            {
+                threadSafe = false;
+                break;
+            }
+        }
+        if(threadSafe)
+        {
+            logger->flush();
+        }
+    }
+}
+
+std::vector<std::shared_ptr<Logger>> Registry::snapshotLoggers()
+{
+    std::vector<std::shared_ptr<Logger>> loggers;
     std::lock_guard<std::mutex> lock(m_mutex);
+    loggers.reserve(m_loggers.size() + 1);
     for(auto& pair : m_loggers)
     {
-        pair.second->flush();
+        loggers.push_back(pair.second);
     }
     if(m_defaultLogger)
     {
-        m_defaultLogger->flush();
+        loggers.push_back(m_defaultLogger);
     }
+    return loggers;
 }
 
 void Registry::ifExistsThrow(const std::string& loggerName)
@@ -98,10 +187,14 @@ void Registry::ifExistsThrow(const std::string& loggerName)
     }
 }
 
-void Registry::initThreadPool(size_t queueSize, size_t threadSize)
+void Registry::initThreadPool(size_t queueSize, size_t threadSize, details::QueueType queueType)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_threadPool = std::make_shared<details::ThreadPool>(queueSize, threadSize);
+    setThreadPool(std::make_shared<details::ThreadPool>(queueSize, threadSize, queueType));
+}
+
+void Registry::initThreadPool(const details::ThreadPoolOptions& options)
+{
+    setThreadPool(std::make_shared<details::ThreadPool>(options));
 }
 
 std::shared_ptr<details::ThreadPool> Registry::getThreadPool()
@@ -117,8 +210,73 @@ std::shared_ptr<details::ThreadPool> Registry::getThreadPool()
 
 void Registry::setThreadPool(std::shared_ptr<details::ThreadPool> threadPool)
 {
+    // 已创建的异步 logger 各自持有旧线程池,替换不会让它们失效
+    // 没有 logger 使用时旧线程池在锁外析构
+    std::shared_ptr<details::ThreadPool> old;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        old = std::move(m_threadPool);
+        m_threadPool = std::move(threadPool);
+    }
+}
+
+void Registry::initThreadPool(const std::string& poolName, const details::ThreadPoolOptions& options)
+{
+    // 先在锁外创建,启动工作线程时不占用注册表的锁
+    setThreadPool(poolName, std::make_shared<details::ThreadPool>(options));
+}
+
+void Registry::setThreadPool(const std::string& poolName, std::shared_ptr<details::ThreadPool> threadPool)
+{
+    if(poolName.empty())
+    {
+        setThreadPool(std::move(threadPool));
+        return;
+    }
+    if(!threadPool)
+    {
+        throw std::invalid_argument("Thread pool '" + poolName + "' must not be null.");
+    }
+
+    std::shared_ptr<details::ThreadPool> old;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& slot = m_threadPools[poolName];
+        old = std::move(slot);
+        slot = std::move(threadPool);
+    }
+    // 旧线程池可能在这里析构并等待工作线程退出,不持有 m_mutex
+}
+
+std::shared_ptr<details::ThreadPool> Registry::getThreadPool(const std::string& poolName)
+{
+    if(poolName.empty())
+    {
+        return getThreadPool();
+    }
+
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_threadPool = std::move(threadPool);
+    auto it = m_threadPools.find(poolName);
+    if(it == m_threadPools.end())
+    {
+        throw std::runtime_error("Thread pool '" + poolName + "' does not exist.");
+    }
+    return it->second;
+}
+
+void Registry::dropThreadPool(const std::string& poolName)
+{
+    std::shared_ptr<details::ThreadPool> old;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_threadPools.find(poolName);
+        if(it == m_threadPools.end())
+        {
+            return;
+        }
+        old = std::move(it->second);
+        m_threadPools.erase(it);
+    }
 }
 
 
@@ -1,14 +1,37 @@
 #include "minispdlog/minispdlog.h"
 #include "minispdlog/async.h"
+#include "minispdlog/staticpatternformatter.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <vector>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <ctime>
+#include <atomic>
+#include <new>
+#include <cstdlib>
 
 using namespace std::chrono;
 
+// 统计全进程的堆分配次数,用于衡量每条异步消息的分配开销
+// 包装 glibc 的 malloc 而不是替换 operator new/delete:operator new 最终也调用 malloc,
+// 只替换其中几个重载会让 new/delete 的配对不一致(Release 下 -Wmismatched-new-delete)
+static std::atomic<size_t> g_alloc_count{0};
+
+#if defined(__GLIBC__)
+#define MINISPDLOG_COUNT_ALLOCS 1
+extern "C" void* __libc_malloc(std::size_t size);
+
+extern "C" void* malloc(std::size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+#else
+#define MINISPDLOG_COUNT_ALLOCS 0
+#endif
+
 class BenchmarkTimer {
 public:
     BenchmarkTimer() : start_(high_resolution_clock::now()) {}
@@ -106,8 +129,7 @@ void benchmark_async_mt(int iterations) {
     }
     double call_time = timer.elapsed_ms();
     
-    logger->flush();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    logger->flushAsync().wait();
     double total_time = timer.elapsed_ms();
     
     results.push_back({
@@ -138,8 +160,7 @@ void benchmark_async_overrun(int iterations) {
     }
     double call_time = timer.elapsed_ms();
     
-    logger->flush();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    logger->flushAsync().wait();
     
     results.push_back({
         "MiniSpdlog - Async Overrun",
@@ -213,8 +234,7 @@ void benchmark_multi_thread_async(int thread_count, int messages_per_thread) {
     }
     
     double call_time = timer.elapsed_ms();
-    logger->flush();
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    logger->flushAsync().wait();
     
     int total_messages = thread_count * messages_per_thread;
     
@@ -229,6 +249,759 @@ void benchmark_multi_thread_async(int thread_count, int messages_per_thread) {
     minispdlog::drop("bench_multi_async");
 }
 
+// 队列实现对比:生产者线程数从 1 扩展到 64
+void benchmark_queue_scaling(minispdlog::details::QueueType queueType, int thread_count, int total_messages) {
+    const char* queue_name = "Blocking";
+    if (queueType == minispdlog::details::QueueType::LockFree) {
+        queue_name = "LockFree";
+    } else if (queueType == minispdlog::details::QueueType::PerThread) {
+        queue_name = "PerThread";
+    } else if (queueType == minispdlog::details::QueueType::ByteRing) {
+        queue_name = "ByteRing";
+    } else if (queueType == minispdlog::details::QueueType::Elastic) {
+        queue_name = "Elastic";
+    }
+    minispdlog::drop("bench_queue_scaling");
+    
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 131072;
+    options.queueType = queueType;
+    options.ringCapacity = 8192;
+    options.ringBytes = 16 * 1024 * 1024; // 约为 131072 个 AsyncMsg 槽位占用的三分之一
+    options.memoryBudget = options.queueSize * sizeof(minispdlog::details::AsyncMsg); // 与 Blocking/LockFree 的槽位占用相同
+    minispdlog::initThreadPool(options);
+    
+    auto logger = minispdlog::asyncFileMTLogger(
+        "bench_queue_scaling",
+        "logs/mini_queue_scaling.log",
+        true,
+        minispdlog::AsyncOverflowPolicy::Block
+    );
+    
+    int messages_per_thread = total_messages / thread_count;
+    BenchmarkTimer timer;
+    std::vector<std::thread> threads;
+    
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([logger, messages_per_thread, t]() {
+            for (int i = 0; i < messages_per_thread; ++i) {
+                logger->info("Thread {} - Message #{}", t, i);
+            }
+        });
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    double call_time = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    
+    int sent_messages = messages_per_thread * thread_count;
+    results.push_back({
+        std::string("MiniSpdlog - Queue ") + queue_name,
+        sent_messages,
+        thread_count,
+        call_time,
+        sent_messages / (call_time / 1000.0)
+    });
+    
+    minispdlog::drop("bench_queue_scaling");
+}
+
+// 记录端到端延迟的 sink:从 LogMsg 创建到后台线程写入 sink 的耗时
+class LatencySink : public minispdlog::sinks::BaseSink<std::mutex> {
+public:
+    std::vector<double> latencies_us() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return latencies_us_;
+    }
+    
+protected:
+    void sinkLog(const minispdlog::details::LogMsg& msg) override {
+        auto now = minispdlog::LogClock::now();
+        latencies_us_.push_back(duration_cast<nanoseconds>(now - msg.m_timePoint).count() / 1e3);
+    }
+    
+    void sinkFlush() override {}
+    
+private:
+    std::vector<double> latencies_us_;
+};
+
+double process_cpu_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+struct LatencyResult {
+    std::string test_name;
+    double avg_us;
+    double p99_us;
+    double idle_cpu_percent;
+    
+    void print() const {
+        std::cout << std::left << std::setw(40) << test_name
+                  << " | " << std::right << std::setw(10) << std::fixed << std::setprecision(2) << avg_us
+                  << " | " << std::setw(10) << std::fixed << std::setprecision(2) << p99_us
+                  << " | " << std::setw(10) << std::fixed << std::setprecision(1) << idle_cpu_percent
+                  << std::endl;
+    }
+};
+
+std::vector<LatencyResult> latency_results;
+
+// 等待策略对比:突发写入的端到端延迟 + 空闲时的 CPU 占用
+void benchmark_wait_strategy(const std::string& name, const minispdlog::details::WaitStrategy& strategy, int bursts, int burst_size) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.waitStrategy = strategy;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<LatencySink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_wait", sink, minispdlog::getThreadPool());
+    
+    for (int b = 0; b < bursts; ++b) {
+        for (int i = 0; i < burst_size; ++i) {
+            logger->info("Burst {} - Message #{}", b, i);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    logger->flushAsync().wait();
+    
+    // 空闲阶段:只有后台线程在等待
+    const int idle_ms = 500;
+    double cpu_begin = process_cpu_ms();
+    std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+    double idle_cpu = process_cpu_ms() - cpu_begin;
+    
+    auto latencies = sink->latencies_us();
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) {
+        sum += latency;
+    }
+    
+    latency_results.push_back({
+        "MiniSpdlog - Wait " + name,
+        latencies.empty() ? 0 : sum / latencies.size(),
+        latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100],
+        idle_cpu / idle_ms * 100.0
+    });
+}
+
+// 多个工作线程共享一个队列时,空闲线程池上 flushAsync().wait() 的耗时
+// 工作线程此时都挂起在队列上,刷新不应等到挂起超时才完成
+void benchmark_flush_latency(const std::string& name, const minispdlog::details::WaitStrategy& strategy, int worker_count, int rounds) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.threadSize = worker_count;
+    options.waitStrategy = strategy;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<LatencySink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_flush_latency", sink, minispdlog::getThreadPool());
+    
+    std::vector<double> latencies;
+    latencies.reserve(rounds);
+    double idle_ms = 0;
+    double idle_cpu = 0;
+    for (int r = 0; r < rounds; ++r) {
+        logger->info("Flush round #{}", r);
+        // 等工作线程写完并重新挂起
+        double cpu_begin = process_cpu_ms();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        idle_cpu += process_cpu_ms() - cpu_begin;
+        idle_ms += 5;
+        
+        BenchmarkTimer timer;
+        logger->flushAsync().wait();
+        latencies.push_back(timer.elapsed_ms() * 1000.0);
+    }
+    
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) {
+        sum += latency;
+    }
+    
+    latency_results.push_back({
+        "MiniSpdlog - Flush " + name + " " + std::to_string(worker_count) + "W",
+        latencies.empty() ? 0 : sum / latencies.size(),
+        latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100],
+        idle_ms > 0 ? idle_cpu / idle_ms * 100.0 : 0
+    });
+}
+
+// 不做任何输出的 sink,只用于隔离队列本身的开销
+class NullSink : public minispdlog::sinks::BaseSink<std::mutex> {
+protected:
+    void sinkLog(const minispdlog::details::LogMsg&) override {}
+    void sinkFlush() override {}
+};
+
+struct AllocResult {
+    std::string test_name;
+    size_t payload_size;
+    double allocs_per_msg;
+    double throughput;
+    
+    void print() const {
+        std::cout << std::left << std::setw(40) << test_name
+                  << " | " << std::right << std::setw(10) << payload_size
+                  << " | " << std::setw(10) << std::fixed << std::setprecision(3) << allocs_per_msg
+                  << " | " << std::setw(12) << std::fixed << std::setprecision(0) << throughput
+                  << std::endl;
+    }
+};
+
+std::vector<AllocResult> alloc_results;
+
+// 每条异步消息的堆分配次数:短 payload 应保存在 AsyncMsg 内联缓冲区中,不产生分配
+void benchmark_async_allocations(size_t payload_size, int iterations) {
+    minispdlog::initThreadPool(131072, 1);
+    
+    auto sink = std::make_shared<NullSink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_alloc", sink, minispdlog::getThreadPool());
+    std::string payload(payload_size, 'x');
+    
+    // 预热:让工作线程的批处理缓冲区等一次性分配先完成
+    for (int i = 0; i < 1000; ++i) {
+        logger->info("{}", payload);
+    }
+    logger->flushAsync().wait();
+    
+    size_t allocs_begin = g_alloc_count.load(std::memory_order_relaxed);
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        logger->info("{}", payload);
+    }
+    double call_time = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    size_t allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs_begin;
+    
+    alloc_results.push_back({
+        "MiniSpdlog - Async Alloc " + std::to_string(payload_size) + "B",
+        payload_size,
+        static_cast<double>(allocs) / iterations,
+        iterations / (call_time / 1000.0)
+    });
+}
+
+// 多个生产者线程共享同一个异步 logger:衡量投递路径上的跨核竞争
+// 队列使用 LockFree、sink 不做输出,剩下的主要是 logger/线程池本身的共享状态
+void benchmark_shared_async_logger(int thread_count, int messages_per_thread) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 131072;
+    options.queueType = minispdlog::details::QueueType::LockFree;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<NullSink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_shared_async", sink, minispdlog::getThreadPool());
+    
+    BenchmarkTimer timer;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&logger, messages_per_thread, t]() {
+            for (int i = 0; i < messages_per_thread; ++i) {
+                logger->info("Thread {} - Message #{}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double call_time = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    
+    int total_messages = thread_count * messages_per_thread;
+    results.push_back({
+        "MiniSpdlog - Shared Async Logger",
+        total_messages,
+        thread_count,
+        call_time,
+        total_messages / (call_time / 1000.0)
+    });
+}
+
+// 延迟格式化:调用线程只序列化参数,fmt 格式化交给后台线程
+void benchmark_deferred_format(bool deferred, int iterations) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 131072;
+    options.queueType = minispdlog::details::QueueType::LockFree;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<NullSink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_deferred", sink, minispdlog::getThreadPool());
+    logger->setDeferredFormat(deferred);
+    std::string user = "alice";
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        logger->info("Request #{} from {} took {:.3f} ms, status {}", i, user, i * 0.001, 200);
+    }
+    double call_time = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    
+    results.push_back({
+        deferred ? "MiniSpdlog - Async Deferred Format" : "MiniSpdlog - Async Eager Format",
+        iterations,
+        1,
+        call_time,
+        iterations / (call_time / 1000.0)
+    });
+}
+
+// 分片线程池:每个 logger 固定由一个工作线程写出,统计增加工作线程后的总吞吐
+void benchmark_sharded_workers(int worker_count, int logger_count, int messages_per_logger) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 16384;
+    options.threadSize = worker_count;
+    options.sharded = true;
+    minispdlog::initThreadPool(options);
+    
+    std::vector<std::shared_ptr<minispdlog::AsyncLogger>> loggers;
+    for (int i = 0; i < logger_count; ++i) {
+        auto sink = std::make_shared<minispdlog::sinks::FileSinkMT>("logs/mini_sharded_" + std::to_string(i) + ".log", true);
+        sink->setFormatter(std::make_unique<minispdlog::PatternFormatter>());
+        auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_sharded_" + std::to_string(i), sink, minispdlog::getThreadPool());
+        logger->setShard(i % worker_count);
+        loggers.push_back(logger);
+    }
+    
+    BenchmarkTimer timer;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < logger_count; ++i) {
+        threads.emplace_back([&loggers, i, messages_per_logger]() {
+            for (int n = 0; n < messages_per_logger; ++n) {
+                loggers[i]->info("Logger {} - Message #{} with some text", i, n);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::vector<std::future<void>> flushes;
+    for (auto& logger : loggers) {
+        flushes.push_back(logger->flushAsync());
+    }
+    for (auto& flush : flushes) {
+        flush.wait();
+    }
+    double elapsed = timer.elapsed_ms();
+    
+    int total_messages = logger_count * messages_per_logger;
+    results.push_back({
+        "MiniSpdlog - Sharded " + std::to_string(worker_count) + " Workers",
+        total_messages,
+        logger_count,
+        elapsed,
+        total_messages / (elapsed / 1000.0)
+    });
+}
+
+// 模拟慢速磁盘:每次写入都要等待一段固定的 I/O 时间
+class SlowSink : public minispdlog::sinks::BaseSink<std::mutex> {
+protected:
+    void sinkLog(const minispdlog::details::LogMsg&) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    void sinkLogBatch(const minispdlog::details::LogMsgBatch&) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    void sinkFlush() override {}
+};
+
+// 倾斜负载:所有 logger 都落在分片 0,其他工作线程只能靠窃取分担
+void benchmark_work_stealing(bool stealing, int worker_count, int logger_count, int messages_per_logger) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 16384;
+    options.threadSize = worker_count;
+    options.sharded = true;
+    options.workStealing = stealing;
+    minispdlog::initThreadPool(options);
+    
+    std::vector<std::shared_ptr<minispdlog::AsyncLogger>> loggers;
+    for (int i = 0; i < logger_count; ++i) {
+        auto sink = std::make_shared<SlowSink>();
+        auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_steal_" + std::to_string(i), sink, minispdlog::getThreadPool());
+        logger->setShard(0);
+        loggers.push_back(logger);
+    }
+    
+    BenchmarkTimer timer;
+    for (int n = 0; n < messages_per_logger; ++n) {
+        for (auto& logger : loggers) {
+            logger->info("Skewed message #{}", n);
+        }
+    }
+    std::vector<std::future<void>> flushes;
+    for (auto& logger : loggers) {
+        flushes.push_back(logger->flushAsync());
+    }
+    for (auto& flush : flushes) {
+        flush.wait();
+    }
+    double elapsed = timer.elapsed_ms();
+    
+    int total_messages = logger_count * messages_per_logger;
+    results.push_back({
+        std::string("MiniSpdlog - Skewed ") + (stealing ? "Stealing" : "No Stealing"),
+        total_messages,
+        worker_count,
+        elapsed,
+        total_messages / (elapsed / 1000.0)
+    });
+}
+
+// 过载:慢速 sink + 小队列,只统计生产者一侧的耗时,比较各溢出策略对调用线程的影响
+void benchmark_overflow_policy(const std::string& name, minispdlog::AsyncOverflowPolicy policy, int iterations) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 1024;
+    options.threadSize = 1;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<SlowSink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_overflow", sink, minispdlog::getThreadPool(), policy);
+    logger->setOverflowTimeout(std::chrono::milliseconds(1));
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        if (i % 1000 == 0) {
+            logger->error("Overflow benchmark error #{}", i);
+        } else {
+            logger->info("Overflow benchmark message #{}", i);
+        }
+    }
+    double elapsed = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    
+    results.push_back({
+        "MiniSpdlog - Overflow " + name + " (dropped " + std::to_string(logger->droppedCount()) + ")",
+        iterations,
+        1,
+        elapsed,
+        iterations / (elapsed / 1000.0)
+    });
+}
+
+// 慢速 sink,记录 critical 消息被写出的时间
+class CriticalTimeSink : public minispdlog::sinks::BaseSink<std::mutex> {
+public:
+    std::chrono::high_resolution_clock::time_point written_at;
+protected:
+    void sinkLog(const minispdlog::details::LogMsg& msg) override {
+        if (msg.m_level == minispdlog::level::critical) {
+            written_at = std::chrono::high_resolution_clock::now();
+        }
+    }
+    void sinkLogBatch(const minispdlog::details::LogMsgBatch& msgs) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        for (const auto* msg : msgs) {
+            sinkLog(*msg);
+        }
+    }
+    void sinkFlush() override {}
+};
+
+// 积压 backlog 条普通消息之后投递一条 critical,测量它被写出前的等待时间
+void benchmark_priority_lane(bool priority_lane, int backlog) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = backlog + 1024;
+    options.threadSize = 1;
+    options.priorityQueueSize = priority_lane ? 64 : 0;
+    minispdlog::initThreadPool(options);
+    
+    auto sink = std::make_shared<CriticalTimeSink>();
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_priority", sink, minispdlog::getThreadPool());
+    for (int i = 0; i < backlog; ++i) {
+        logger->info("Backlog message #{} with some text", i);
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    logger->critical("Critical message");
+    logger->flushAsync().wait();
+    double latency = std::chrono::duration<double, std::milli>(sink->written_at - start).count();
+    
+    results.push_back({
+        std::string("MiniSpdlog - Critical Latency ") + (priority_lane ? "Priority Lane" : "Single Lane"),
+        backlog + 1,
+        1,
+        latency,
+        (backlog + 1) / (latency / 1000.0)
+    });
+}
+
+// 吵闹邻居:chatty logger 写慢 sink 并持续占满共享队列,记录 quiet logger 单次调用的最长耗时与写出延迟
+// 配额(quota)与公平调度(fair_quantum)分开设置,各自的效果单独比较
+void benchmark_queue_quota(size_t quota, size_t fair_quantum, int quiet_messages) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 1024;
+    options.threadSize = 1;
+    options.fairQuantum = fair_quantum;
+    minispdlog::initThreadPool(options);
+    
+    auto chatty = std::make_shared<minispdlog::AsyncLogger>("bench_chatty", std::make_shared<SlowSink>(), minispdlog::getThreadPool());
+    auto quiet_sink = std::make_shared<LatencySink>();
+    auto quiet = std::make_shared<minispdlog::AsyncLogger>("bench_quiet", quiet_sink, minispdlog::getThreadPool());
+    chatty->setQueueQuota(quota);
+    
+    std::atomic<bool> stop{false};
+    std::thread noisy([&] {
+        for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+            chatty->info("Chatty message #{} with some text", i);
+        }
+    });
+    std::this_thread::sleep_for(milliseconds(50));
+    
+    double worst = 0;
+    for (int i = 0; i < quiet_messages; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        quiet->info("Quiet message #{}", i);
+        worst = std::max(worst, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        std::this_thread::sleep_for(microseconds(500));
+    }
+    stop = true;
+    noisy.join();
+    chatty->flushAsync().wait();
+    quiet->flushAsync().wait();
+    
+    std::string name = "Quota " + std::to_string(quota) + " / Fair " + std::to_string(fair_quantum);
+    results.push_back({
+        "MiniSpdlog - Quiet Worst Call " + name,
+        quiet_messages,
+        2,
+        worst,
+        quiet_messages / (worst / 1000.0)
+    });
+    
+    auto latencies = quiet_sink->latencies_us();
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) {
+        sum += latency;
+    }
+    latency_results.push_back({
+        "MiniSpdlog - Quiet Write " + name,
+        latencies.empty() ? 0 : sum / latencies.size(),
+        latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100],
+        0
+    });
+}
+
+// 队列统计的开销:多个生产者共享一个 logger,比较开启/关闭统计时的调用耗时
+void benchmark_queue_stats(bool collect_stats, int thread_count, int messages_per_thread) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = 65536;
+    options.threadSize = 1;
+    options.collectStats = collect_stats;
+    minispdlog::initThreadPool(options);
+    
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_stats", std::make_shared<NullSink>(), minispdlog::getThreadPool());
+    
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&logger, messages_per_thread, t]() {
+            for (int i = 0; i < messages_per_thread; ++i) {
+                logger->info("Thread {} message #{}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    logger->flushAsync().wait();
+    
+    double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+    int total = thread_count * messages_per_thread;
+    results.push_back({
+        std::string("MiniSpdlog - Queue Stats ") + (collect_stats ? "On" : "Off"),
+        total,
+        thread_count,
+        elapsed,
+        total / (elapsed / 1000.0)
+    });
+    
+    if (collect_stats) {
+        auto stats = minispdlog::getThreadPool()->stats();
+        std::cout << "  队列高水位 " << stats.highWaterMark
+                  << ",阻塞 " << stats.blockCount << " 次"
+                  << ",驻留时间 p50/p99/max = "
+                  << stats.residency.percentile(0.5) / 1e3 << "/"
+                  << stats.residency.percentile(0.99) / 1e3 << "/"
+                  << stats.residency.maxNs / 1e3 << " us" << std::endl;
+    }
+}
+
+// 关闭耗时:队列积压 backlog 条写慢 sink 的消息时,不同关闭方式的耗时
+void benchmark_shutdown(const std::string& name, minispdlog::details::ShutdownMode mode, int backlog) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueSize = backlog;
+    options.threadSize = 1;
+    auto pool = std::make_shared<minispdlog::details::ThreadPool>(options);
+    
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_shutdown", std::make_shared<SlowSink>(), pool);
+    for (int i = 0; i < backlog; ++i) {
+        logger->info("Backlog message #{} with some text", i);
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = pool->shutdown(mode, milliseconds(50));
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+    
+    results.push_back({
+        "MiniSpdlog - Shutdown " + name,
+        backlog,
+        1,
+        elapsed,
+        backlog / (elapsed / 1000.0)
+    });
+    std::cout << "  " << name << ":写出 " << result.drained << " 条,丢弃 " << result.discarded << " 条" << std::endl;
+}
+
+// 编译期 pattern 与运行期 pattern 的格式化开销
+static constexpr char BENCH_PATTERN[] = "[%Y-%m-%d %H:%M:%S] [%t] [%l] [%n] %v";
+
+void benchmark_formatter(const std::string& name, minispdlog::Formatter& formatter, int iterations) {
+    minispdlog::details::LogMsg msg("bench_formatter", minispdlog::level::info, "Benchmark message with some text");
+    fmt::memory_buffer dest;
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        dest.clear();
+        formatter.format(msg, dest);
+    }
+    double elapsed = timer.elapsed_ms();
+    
+    results.push_back({
+        "MiniSpdlog - Formatter " + name,
+        iterations,
+        1,
+        elapsed,
+        iterations / (elapsed / 1000.0)
+    });
+    std::cout << "  " << name << ":" << std::fixed << std::setprecision(1)
+              << elapsed * 1e6 / iterations << " ns/条" << std::endl;
+}
+
+// 每个 sink 都持有 formatter 的副本,clone 的开销影响 setPattern/setFormatter
+void benchmark_formatter_clone(int iterations) {
+    minispdlog::PatternFormatter formatter(BENCH_PATTERN);
+    size_t cloned = 0;
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        auto copy = formatter.clone();
+        cloned += copy != nullptr;
+    }
+    double elapsed = timer.elapsed_ms();
+    
+    results.push_back({
+        "MiniSpdlog - Formatter Clone",
+        static_cast<int>(cloned),
+        1,
+        elapsed,
+        iterations / (elapsed / 1000.0)
+    });
+}
+
+// 每条消息的秒数都不同(最坏情况):每条都要重新换算日历字段并渲染时间段
+// "localtime_r" 一行只调用 localtime_r,作为换算前的对照
+void benchmark_time_conversion(const std::string& name, minispdlog::Formatter* formatter, int iterations) {
+    minispdlog::details::LogMsg msg("bench_time", minispdlog::level::info, "Benchmark message with some text");
+    auto base = msg.m_timePoint;
+    fmt::memory_buffer dest;
+    std::tm tmVal{};
+    int checksum = 0;
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        msg.m_timePoint = base + std::chrono::seconds(i);
+        if (formatter) {
+            dest.clear();
+            formatter->format(msg, dest);
+        } else {
+            auto timeT = minispdlog::LogClock::to_time_t(msg.m_timePoint);
+            localtime_r(&timeT, &tmVal);
+            checksum += tmVal.tm_sec;
+        }
+    }
+    double elapsed = timer.elapsed_ms();
+    
+    results.push_back({
+        "MiniSpdlog - Time Conversion " + name,
+        iterations,
+        1,
+        elapsed,
+        iterations / (elapsed / 1000.0)
+    });
+    std::cout << "  " << name << ":" << std::fixed << std::setprecision(1)
+              << elapsed * 1e6 / iterations << " ns/条" << (checksum < 0 ? " " : "") << std::endl;
+}
+
+// 弹性队列:突发期间按块增长,取空后释放,空闲时只占用一个块
+void benchmark_elastic_memory(int burst) {
+    minispdlog::details::ThreadPoolOptions options;
+    options.queueType = minispdlog::details::QueueType::Elastic;
+    options.threadSize = 1;
+    options.memoryBudget = 64 * 1024 * 1024;
+    auto pool = std::make_shared<minispdlog::details::ThreadPool>(options);
+    size_t idle_before = pool->memoryUsed();
+    
+    auto logger = std::make_shared<minispdlog::AsyncLogger>("bench_elastic", std::make_shared<NullSink>(), pool);
+    size_t peak = 0;
+    BenchmarkTimer timer;
+    for (int i = 0; i < burst; ++i) {
+        logger->info("Burst message #{} with some text", i);
+        if (i % 1024 == 0) {
+            peak = std::max(peak, pool->memoryUsed());
+        }
+    }
+    double elapsed = timer.elapsed_ms();
+    logger->flushAsync().wait();
+    size_t idle_after = pool->memoryUsed();
+    
+    results.push_back({
+        "MiniSpdlog - Elastic Burst",
+        burst,
+        1,
+        elapsed,
+        burst / (elapsed / 1000.0)
+    });
+    std::cout << "  Elastic:空闲 " << idle_before / 1024 << " KB,突发峰值 " << peak / 1024
+              << " KB,取空后 " << idle_after / 1024 << " KB(Blocking 8192 槽位固定占用 "
+              << 8192 * sizeof(minispdlog::details::AsyncMsg) / 1024 << " KB)" << std::endl;
+}
+
+void benchmark_flush_policy(bool periodic, int iterations) {
+    minispdlog::drop("bench_flush_policy");
+    auto logger = minispdlog::fileLoggerMTLogger("bench_flush_policy", "logs/mini_flush_policy.log", true);
+    if (periodic) {
+        minispdlog::flushEvery(milliseconds(100));
+    } else {
+        logger->flushOn(minispdlog::level::info);
+    }
+    
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        logger->info("Benchmark message #{} with some text", i);
+    }
+    double elapsed = timer.elapsed_ms();
+    minispdlog::flushEvery(milliseconds(0));
+    
+    results.push_back({
+        periodic ? "MiniSpdlog - Flush Every 100ms" : "MiniSpdlog - Flush On Info",
+        iterations,
+        1,
+        elapsed,
+        iterations / (elapsed / 1000.0)
+    });
+    
+    minispdlog::drop("bench_flush_policy");
+}
+
 int main() {
     system("mkdir -p logs");
     
@@ -258,6 +1031,143 @@ int main() {
     benchmark_multi_thread_sync(MULTI_THREADS, MULTI_MESSAGES);
     benchmark_multi_thread_async(MULTI_THREADS, MULTI_MESSAGES);
     
+    // 队列扩展性测试
+    std::cout << "执行队列扩展性测试..." << std::endl;
+    const int SCALING_MESSAGES = 256000;
+    for (int producers : {1, 2, 4, 8, 16, 32, 64}) {
+        benchmark_queue_scaling(minispdlog::details::QueueType::Blocking, producers, SCALING_MESSAGES);
+        benchmark_queue_scaling(minispdlog::details::QueueType::LockFree, producers, SCALING_MESSAGES);
+        benchmark_queue_scaling(minispdlog::details::QueueType::PerThread, producers, SCALING_MESSAGES);
+        benchmark_queue_scaling(minispdlog::details::QueueType::ByteRing, producers, SCALING_MESSAGES);
+        benchmark_queue_scaling(minispdlog::details::QueueType::Elastic, producers, SCALING_MESSAGES);
+    }
+    
+    // 等待策略测试
+    std::cout << "执行等待策略测试..." << std::endl;
+    benchmark_wait_strategy("LowLatency", minispdlog::details::WaitStrategy::lowLatency(), 200, 16);
+    benchmark_wait_strategy("Balanced", minispdlog::details::WaitStrategy::balanced(), 200, 16);
+    benchmark_wait_strategy("LowCpu", minispdlog::details::WaitStrategy::lowCpu(), 200, 16);
+    
+    // 多工作线程的刷新延迟
+    std::cout << "执行刷新延迟测试..." << std::endl;
+    benchmark_flush_latency("Balanced", minispdlog::details::WaitStrategy::balanced(), 4, 100);
+    benchmark_flush_latency("LowCpu", minispdlog::details::WaitStrategy::lowCpu(), 4, 100);
+    
+    // 共享 logger 的多线程投递
+    std::cout << "执行共享 logger 测试..." << std::endl;
+    for (int producers : {1, 2, 4, 8}) {
+        benchmark_shared_async_logger(producers, 100000);
+    }
+    
+    // 分片线程池
+    std::cout << "执行分片线程池测试..." << std::endl;
+    for (int workers : {1, 2, 4, 8}) {
+        benchmark_sharded_workers(workers, 8, 50000);
+    }
+    
+    // 工作窃取
+    std::cout << "执行工作窃取测试..." << std::endl;
+    benchmark_work_stealing(false, 4, 4, 20000);
+    benchmark_work_stealing(true, 4, 4, 20000);
+    
+    // 优先通道:elapsed 列为 critical 消息的等待时间
+    std::cout << "执行优先通道测试..." << std::endl;
+    benchmark_priority_lane(false, 20000);
+    benchmark_priority_lane(true, 20000);
+    
+    // 在途配额:elapsed 列为 quiet logger 单次调用的最长耗时
+    std::cout << "执行在途配额测试..." << std::endl;
+    benchmark_queue_quota(0, 0, 100);
+    benchmark_queue_quota(64, 0, 100);
+    benchmark_queue_quota(0, 4096, 100);
+    benchmark_queue_quota(64, 4096, 100);
+    
+    // 队列统计开销
+    std::cout << "执行队列统计测试..." << std::endl;
+    benchmark_queue_stats(false, 4, 100000);
+    benchmark_queue_stats(true, 4, 100000);
+    
+    // 关闭方式:elapsed 列为 shutdown 的耗时
+    std::cout << "执行关闭测试..." << std::endl;
+    benchmark_shutdown("DrainAll", minispdlog::details::ShutdownMode::DrainAll, 50000);
+    benchmark_shutdown("DrainUntil", minispdlog::details::ShutdownMode::DrainUntil, 50000);
+    benchmark_shutdown("Discard", minispdlog::details::ShutdownMode::Discard, 50000);
+    
+    // 格式化器
+    std::cout << "执行格式化器测试..." << std::endl;
+    {
+        minispdlog::PatternFormatter runtime_formatter(BENCH_PATTERN);
+        minispdlog::StaticPatternFormatter<BENCH_PATTERN> static_formatter;
+        benchmark_formatter("Runtime", runtime_formatter, 2000000);
+        benchmark_formatter("Static", static_formatter, 2000000);
+        
+        // 时间段按秒缓存之后,时间部分应与复制同样长度的普通文本相当
+        minispdlog::PatternFormatter time_formatter("[%Y-%m-%d %H:%M:%S] %v");
+        minispdlog::PatternFormatter literal_formatter("[2024-01-01 00:00:00] %v");
+        benchmark_formatter("Time Prefix", time_formatter, 2000000);
+        benchmark_formatter("Literal Prefix", literal_formatter, 2000000);
+        
+        // 秒以下/距上一条消息的占位符:与前一行相比的差值即为该占位符的开销
+        // 时间段内的 %e/%f/%F 在复制缓存之后按位置写入,段外的单独执行
+        const std::pair<const char*, const char*> subsecond_patterns[] = {
+            {"Second", "[%H:%M:%S] %v"},
+            {"Second + Millis", "[%H:%M:%S.%e] %v"},
+            {"Second + Micros", "[%H:%M:%S.%f] %v"},
+            {"Second + Nanos", "[%H:%M:%S.%F] %v"},
+            {"Payload + Literal", "%v 000"},
+            {"Payload + Millis", "%v %e"},
+            {"Payload + Elapsed Ms", "%v %o"},
+            {"Payload + Elapsed Ns", "%v %u"},
+        };
+        for (const auto& pattern : subsecond_patterns) {
+            minispdlog::PatternFormatter formatter(pattern.second);
+            benchmark_formatter(pattern.first, formatter, 2000000);
+        }
+    }
+    benchmark_formatter_clone(200000);
+    
+    // 时区:Local 使用缓存的 UTC 偏移,Utc 不读取时区
+    std::cout << "执行时间换算测试..." << std::endl;
+    {
+        static constexpr char TIME_PATTERN[] = "[%Y-%m-%d %H:%M:%S %z] %v";
+        minispdlog::PatternFormatter local_formatter(TIME_PATTERN);
+        minispdlog::PatternFormatter utc_formatter(TIME_PATTERN, minispdlog::PatternTimeType::Utc);
+        minispdlog::StaticPatternFormatter<TIME_PATTERN> static_local_formatter;
+        benchmark_time_conversion("localtime_r", nullptr, 1000000);
+        benchmark_time_conversion("Local", &local_formatter, 1000000);
+        benchmark_time_conversion("Utc", &utc_formatter, 1000000);
+        benchmark_time_conversion("Static Local", &static_local_formatter, 1000000);
+    }
+    
+    // 弹性队列的内存占用
+    std::cout << "执行弹性队列测试..." << std::endl;
+    benchmark_elastic_memory(200000);
+    
+    // 刷新方式:每条消息刷新与后台周期刷新
+    std::cout << "执行刷新方式测试..." << std::endl;
+    benchmark_flush_policy(false, 200000);
+    benchmark_flush_policy(true, 200000);
+    
+    // 溢出策略
+    std::cout << "执行溢出策略测试..." << std::endl;
+    benchmark_overflow_policy("Block", minispdlog::AsyncOverflowPolicy::Block, 20000);
+    benchmark_overflow_policy("DiscardNew", minispdlog::AsyncOverflowPolicy::DiscardNew, 200000);
+    benchmark_overflow_policy("BlockTimeout", minispdlog::AsyncOverflowPolicy::BlockTimeout, 20000);
+    benchmark_overflow_policy("LevelProtected", minispdlog::AsyncOverflowPolicy::LevelProtected, 200000);
+    
+    // 延迟格式化
+    std::cout << "执行延迟格式化测试..." << std::endl;
+    benchmark_deferred_format(false, SINGLE_ITERATIONS);
+    benchmark_deferred_format(true, SINGLE_ITERATIONS);
+    
+    // 每条消息的堆分配次数(只在能包装 malloc 的平台上统计)
+    if (MINISPDLOG_COUNT_ALLOCS) {
+        std::cout << "执行分配次数测试..." << std::endl;
+        for (size_t payload_size : {16, 64, 200, 400}) {
+            benchmark_async_allocations(payload_size, 200000);
+        }
+    }
+    
     // 打印结果
     std::cout << "\n========================================" << std::endl;
     std::cout << "测试结果汇总" << std::endl;
@@ -275,6 +1185,28 @@ int main() {
         result.print();
     }
     
+    std::cout << "\n" << std::left << std::setw(40) << "等待策略"
+              << " | " << std::right << std::setw(10) << "平均(us)"
+              << " | " << std::setw(10) << "P99(us)"
+              << " | " << std::setw(10) << "空闲CPU(%)"
+              << std::endl;
+    std::cout << std::string(90, '-') << std::endl;
+    
+    for (const auto& result : latency_results) {
+        result.print();
+    }
+    
+    std::cout << "\n" << std::left << std::setw(40) << "分配次数"
+              << " | " << std::right << std::setw(10) << "payload(B)"
+              << " | " << std::setw(10) << "次/消息"
+              << " | " << std::setw(12) << "吞吐量(msg/s)"
+              << std::endl;
+    std::cout << std::string(90, '-') << std::endl;
+    
+    for (const auto& result : alloc_results) {
+        result.print();
+    }
+    
     // 保存结果到文件
     std::ofstream out("results/minispdlog_results.txt");
     out << "MiniSpdlog Benchmark Results\n\n";
@@ -282,6 +1214,14 @@ int main() {
         out << result.test_name << ": " 
             << result.throughput << " msg/sec\n";
     }
+    for (const auto& result : latency_results) {
+        out << result.test_name << ": avg " << result.avg_us << " us, p99 "
+            << result.p99_us << " us, idle cpu " << result.idle_cpu_percent << "%\n";
+    }
+    for (const auto& result : alloc_results) {
+        out << result.test_name << ": " << result.allocs_per_msg << " allocs/msg, "
+            << result.throughput << " msg/sec\n";
+    }
     out.close();
     
     std::cout << "\n结果已保存到 results/minispdlog_results.txt" << std::endl;